@@ -1,26 +1,209 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include <boost/asio.hpp>
+#include "IoUring.h"
 
 using boost::asio::ip::tcp;
 
 class ConnectionHandler {
+public:
+	// Received bytes shared by every frame view cut out of them. A slab is only
+	// reused for new reads once nobody else holds it.
+	typedef std::shared_ptr<const std::vector<char>> Slab;
+
+	// Called on the event loop for every frame read in asynchronous mode, with the frame
+	// (without its delimiter) viewed inside the slab that keeps it alive.
+	// Return false to stop reading.
+	typedef std::function<bool(std::string_view frame, const Slab &slab)> FrameHandler;
+	// Called on the event loop once the connection is closed by the remote host.
+	typedef std::function<void()> CloseHandler;
+
+	// Finds where the first frame in pending (the unconsumed bytes, starting at a frame) ends.
+	// Returns its length including the terminating byte, or 0 if it is not complete yet.
+	// It is called again with more bytes appended, so it may remember how far it got.
+	typedef std::function<size_t(std::string_view pending)> FrameSplitter;
+
+	// When the asynchronous send queue is written out. Everything queued at that point
+	// leaves in a single gathered write.
+	struct FlushPolicy {
+		enum Mode {
+			IMMEDIATE,       // write as soon as the socket is idle
+			SIZE_THRESHOLD,  // wait until sizeThreshold bytes are queued, or at most deadlineMicros
+			DEADLINE         // wait at most deadlineMicros after the first queued frame
+		};
+		Mode mode;
+		size_t sizeThreshold;
+		long deadlineMicros;
+		bool cork;  // TCP_CORK around every write, so a batch leaves in full segments
+
+		FlushPolicy() : mode(IMMEDIATE), sizeThreshold(0), deadlineMicros(0), cork(false) {}
+	};
+
+	// How the blocking reads and writes reach the kernel.
+	enum class Transport {
+		BOOST,    // read_some / write on the asio socket
+		IO_URING  // io_uring with the receive buffer registered; falls back to BOOST if unavailable
+	};
+
+	// Socket level tuning applied by connect(). Zero sizes/timings keep the kernel default.
+	struct SocketOptions {
+		int sendBufferSize;     // SO_SNDBUF in bytes
+		int receiveBufferSize;  // SO_RCVBUF in bytes
+		bool noDelay;           // TCP_NODELAY: don't let Nagle hold back small frames
+		bool quickAck;          // TCP_QUICKACK, re-armed after every read since the kernel clears it
+		int busyPollMicros;     // SO_BUSY_POLL
+		bool keepAlive;         // SO_KEEPALIVE with the timings below (seconds)
+		int keepAliveIdle;      // TCP_KEEPIDLE
+		int keepAliveInterval;  // TCP_KEEPINTVL
+		int keepAliveCount;     // TCP_KEEPCNT
+
+		SocketOptions() : sendBufferSize(0), receiveBufferSize(0), noDelay(true), quickAck(false),
+		                  busyPollMicros(0), keepAlive(false), keepAliveIdle(0), keepAliveInterval(0),
+		                  keepAliveCount(0) {}
+	};
+
 private:
+	// A write waiting in the asynchronous send queue. Either owns its bytes in data,
+	// or points (through buffers) at memory kept alive by a blocked sender.
+	struct PendingWrite {
+		std::string data;
+		std::vector<boost::asio::const_buffer> buffers;
+		std::function<void(bool)> done;
+		bool flush;   // write out everything queued up to here without waiting for the policy
+		bool pooled;  // owns data and goes back to the pool, capacity and all, once written
+
+		PendingWrite() : data(), buffers(), done(), flush(false), pooled(false) {}
+	};
+
+	// A buffer sequence referring to a vector instead of copying it, which async_write would do
+	// for every batch. The vector must outlive the write.
+	struct BufferList {
+		typedef boost::asio::const_buffer value_type;
+		typedef std::vector<boost::asio::const_buffer>::const_iterator const_iterator;
+		const std::vector<boost::asio::const_buffer> *buffers;
+
+		const_iterator begin() const { return buffers->begin(); }
+		const_iterator end() const { return buffers->end(); }
+	};
+
 	const std::string host_;
-	const short port_;
-	boost::asio::io_service io_service_;   // Provides core I/O functionality
-	tcp::socket socket_;
+	const unsigned short port_;
+	const bool local_;  // host_ is "unix:<path>", an AF_UNIX stream socket to a co-located server
+	SocketOptions socketOptions_;
+	Transport transport_;
+	boost::asio::io_service ownService_;   // Used unless an external io_service is given
+	boost::asio::io_service &io_service_;  // Provides core I/O functionality
+	// A generic stream socket, so the same handler talks TCP or AF_UNIX.
+	boost::asio::generic::stream_protocol::socket socket_;
+	boost::asio::io_service::strand strand_;  // Serializes all asynchronous completion handlers
+
+	// Bytes already received from the socket but not yet handed out.
+	// Valid data lives in [inStart_, inEnd_) of the current slab.
+	std::shared_ptr<std::vector<char>> inSlab_;
+	size_t inStart_;
+	size_t inEnd_;
+
+	// Make room after the unconsumed bytes, moving them to the front of the slab, or of a
+	// fresh one if frame views still point into the current slab.
+	void prepareSlab();
+	// prepareSlab() and a single blocking read into the free space.
+	// Returns false in case the connection is closed.
+	bool fillSlab();
+
+	// Asynchronous mode state. The queue and the handlers are only touched on the strand.
+	// asyncMode_ is set by startAsyncRead while other threads may already be sending.
+	std::atomic<bool> asyncMode_;
+	FrameSplitter splitter_;
+	FrameHandler onFrame_;
+	CloseHandler onClose_;
+	std::vector<std::shared_ptr<PendingWrite>> writeQueue_;
+	bool writing_;
+	// The batch being written and its gathered buffers; kept between writes for their capacity.
+	std::vector<std::shared_ptr<PendingWrite>> inFlight_;
+	std::vector<boost::asio::const_buffer> writeBuffers_;
+	FlushPolicy flushPolicy_;
+	size_t queuedBytes_;
+	bool flushDue_;  // set by a flushing write, flush() or the deadline timer
+	bool timerArmed_;
+	unsigned long timerGeneration_;  // bumped on every arm and cancel, so a stale expiry is ignored
+	boost::asio::steady_timer flushTimer_;
+	// Keeps run() alive while the read loop is active; guarded by asyncMtx_
+	std::unique_ptr<boost::asio::io_service::work> work_;
+	std::mutex asyncMtx_;
+
+	// Writes handed over by other threads until the strand moves them to writeQueue_. Only the
+	// first one staged since the last drain posts to the strand. Guarded by stagedMtx_, like the
+	// pool of written PendingWrites kept for reuse.
+	std::vector<std::shared_ptr<PendingWrite>> staged_;
+	bool drainPosted_;
+	std::vector<std::shared_ptr<PendingWrite>> freeWrites_;
+	std::mutex stagedMtx_;
+
+	// io_uring transport: one ring per direction since reads and writes come from different threads.
+	std::unique_ptr<IoUring> readRing_;
+	std::unique_ptr<IoUring> writeRing_;
+	std::shared_ptr<std::vector<char>> registeredSlab_;  // pinned for READ_FIXED, never freed before the ring
+	std::atomic<bool> loopStopped_;
+
+	void setUpIoUring();
+	// Blocking read through the selected transport; returns bytes read, 0 on error/EOF.
+	size_t readSome(char *buf, size_t len, boost::system::error_code &error);
+	// Blocking gathered write through io_uring.
+	bool ringWrite(const std::vector<boost::asio::const_buffer> &buffers);
+
+	void readNext();
+	void endAsyncRead();
+	// The splitter threw: the stream cannot be framed any more, so report it and drop the connection.
+	void failAsyncRead(const std::exception &error);
+	void enqueueWrite(std::shared_ptr<PendingWrite> write);
+	void drainStaged();
+	// A pooled PendingWrite, or a new one if the pool is empty.
+	std::shared_ptr<PendingWrite> takeWrite();
+	// Puts a pooled write back once it is written; the pointer is left empty.
+	void recycleWrite(std::shared_ptr<PendingWrite> &write);
+	// Queues a write whose data is filled in (io_uring transport: writes it straight away).
+	void queueOwnedWrite(std::shared_ptr<PendingWrite> write);
+	void writeNext();
+	void cancelFlushTimer();
+	void applySocketOptions();
+	void applyQuickAck();
+	void setCork(bool cork);
 
 public:
-	ConnectionHandler(std::string host, short port);
+	// Size of a single read from the socket into the receive buffer.
+	static constexpr size_t RECEIVE_CHUNK = 8192;
+	// Host prefix selecting a Unix domain socket, e.g. "unix:/tmp/stomp.sock".
+	static const std::string UNIX_PREFIX;
+	// Submission queue size of each io_uring.
+	static constexpr unsigned RING_ENTRIES = 8;
+	// Written PendingWrites kept for reuse, and the largest buffer one may keep.
+	static constexpr size_t WRITE_POOL_SIZE = 256;
+	static constexpr size_t POOLED_WRITE_BYTES = 64 * 1024;
+
+	ConnectionHandler(std::string host, unsigned short port, const SocketOptions &options = SocketOptions(),
+	                  Transport transport = Transport::BOOST);
+
+	// Use an io_service shared with other sessions; whoever calls run() on it drives this connection too.
+	ConnectionHandler(boost::asio::io_service &io_service, std::string host, unsigned short port,
+	                  const SocketOptions &options = SocketOptions(), Transport transport = Transport::BOOST);
 
 	virtual ~ConnectionHandler();
 
-	// Connect to the remote machine
+	// Connect to the remote machine, applying the socket options first.
+	// A host of the form "unix:<path>" connects to a Unix domain socket and ignores the port.
 	bool connect();
 
+	// Replace the socket options used by the next connect().
+	void setSocketOptions(const SocketOptions &options);
+
 	// Read a fixed number of bytes from the server - blocking.
 	// Returns false in case the connection is closed before bytesToRead bytes can be read.
 	bool getBytes(char bytes[], unsigned int bytesToRead);
@@ -29,6 +212,10 @@ public:
 	// Returns false in case the connection is closed before all the data is sent.
 	bool sendBytes(const char bytes[], int bytesToWrite);
 
+	// Send a sequence of buffers as one gathered write - blocking.
+	// Returns false in case the connection is closed before all the data is sent.
+	bool sendBuffers(const std::vector<boost::asio::const_buffer> &buffers);
+
 	// Read an ascii line from the server
 	// Returns false in case connection closed before a newline can be read.
 	bool getLine(std::string &line);
@@ -41,10 +228,69 @@ public:
 	// Returns false in case connection closed before null can be read.
 	bool getFrameAscii(std::string &frame, char delimiter);
 
+	// Like getFrameAscii, but without copying: frame views the bytes up to (not including)
+	// the delimiter inside slab, and stays valid for as long as slab is held.
+	// Returns false in case connection closed before the delimiter can be read.
+	bool getFrameView(std::string_view &frame, Slab &slab, char delimiter);
+
+	// Same, with frame boundaries decided by a protocol aware splitter (e.g. honouring content-length).
+	bool getFrameView(std::string_view &frame, Slab &slab, FrameSplitter &splitter);
+
+	// A splitter cutting frames at the first delimiter byte.
+	static FrameSplitter delimiterSplitter(char delimiter);
+
 	// Send a message to the remote host.
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
 
+	// Switch to asynchronous mode: the socket is read with async_read_some into the receive slab
+	// and every frame up to the delimiter is handed to onFrame (as a view) on the event loop;
+	// onClose is called if the connection ends.
+	// Once in asynchronous mode the blocking send functions queue their data behind earlier
+	// writes and wait for it to be written (never call them from a completion handler).
+	// With the io_uring transport the frames are instead read by a blocking loop inside run(),
+	// and sends are written straight through the ring.
+	void startAsyncRead(char delimiter, FrameHandler onFrame, CloseHandler onClose);
+
+	// Same, with frame boundaries decided by the splitter; onFrame gets the frame without its last byte.
+	// If the splitter throws (a malformed frame), the connection is closed and onClose is called.
+	void startAsyncRead(FrameSplitter splitter, FrameHandler onFrame, CloseHandler onClose);
+
+	// Queue a message for the remote host and return immediately (asynchronous mode).
+	// It is written according to the flush policy, together with whatever else is queued.
+	void asyncSendFrameAscii(const std::string &frame, char delimiter);
+
+	// Same, for a message that serialize(std::string &out) appends, delimiter included, to a
+	// recycled send buffer. Once the pool and its buffers have grown, queuing copies nothing and
+	// allocates nothing apart from waking the event loop once per batch.
+	template <typename Serializer>
+	void asyncSendSerialized(Serializer serialize) {
+		std::shared_ptr<PendingWrite> write = takeWrite();
+		serialize(write->data);
+		queueOwnedWrite(std::move(write));
+	}
+
+	// Write out the asynchronous send queue now, regardless of the flush policy.
+	void flush();
+
+	// Set how queued writes are coalesced. Blocking sends always flush the queue.
+	// A DEADLINE of zero is IMMEDIATE; a SIZE_THRESHOLD without a deadline would hold a short
+	// tail back forever and throws std::invalid_argument. Takes effect on the event loop.
+	void setFlushPolicy(const FlushPolicy &policy);
+
+	// Run the event loop on the calling thread until there is no asynchronous work left
+	// (io_uring transport: until the read loop ends).
+	void run();
+
+	// Stop the event loop, pending handlers are not called.
+	void stop();
+
+	// The event loop driving this connection, e.g. for timers.
+	boost::asio::io_service &getIoService();
+
+	// The transport actually in use (IO_URING may have fallen back to BOOST).
+	Transport getTransport() const;
+
 	// Close down the connection properly.
 	void close();
 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "event.h"
+#include "EventsScanner.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A compact binary form of an events file (.evb), made from the json by EvbConverter so report
+// does not have to parse json. All integers are little endian.
+//
+//   header:  "STOMPEVB", u32 version, u64 event count, team a, team b
+//   event:   name, i32 time, game updates, team a updates, team b updates, description
+//   updates: u32 count, then count times a key and a value
+//   key:     u32 id; ids are handed out in order of first use, so an id equal to the number of
+//            keys seen so far is a new key and its string follows
+//   string:  u32 length, then the bytes
+namespace EventBinary {
+    static constexpr char MAGIC[8] = {'S', 'T', 'O', 'M', 'P', 'E', 'V', 'B'};
+    static constexpr uint32_t VERSION = 1;
+
+    // true if data starts like an .evb file
+    bool matches(std::string_view data);
+}
+
+// Writes an .evb file one event at a time
+class EventBinaryWriter {
+private:
+    std::ofstream out;
+    std::string path;
+    std::string buffer;  // the event being written
+    std::unordered_map<std::string, uint32_t> keys;
+    uint64_t count;
+
+    void putUpdates(const std::map<std::string, std::string> &updates);
+    void putKey(const std::string &key);
+
+public:
+    // Throws std::runtime_error if path cannot be created
+    EventBinaryWriter(const std::string &path, const std::string &team_a_name, const std::string &team_b_name);
+    EventBinaryWriter(const EventBinaryWriter &) = delete;
+    EventBinaryWriter &operator=(const EventBinaryWriter &) = delete;
+
+    void write(const Event &event);
+    uint64_t written() const { return count; }
+
+    // Fills in the event count. Throws std::runtime_error if the file could not be written.
+    void finish();
+};
+
+// Reads an .evb file mapped into memory. Like EventsScanner, the views it returns point into
+// the data it was given; nothing is copied.
+class EventBinaryReader {
+private:
+    std::string_view data;
+    size_t pos;
+    uint64_t remaining;
+    std::string_view team_a_name;
+    std::string_view team_b_name;
+    std::vector<std::string_view> keys;
+
+    uint32_t u32();
+    std::string_view string();
+    void updates(EventsScanner::Updates &out);
+
+public:
+    // Reads the header. Throws std::runtime_error if data is not a complete .evb header.
+    explicit EventBinaryReader(std::string_view data);
+
+    std::string_view teamA() const { return team_a_name; }
+    std::string_view teamB() const { return team_b_name; }
+
+    // Reads the next event into event; false after the last one.
+    // Throws std::runtime_error on a truncated or corrupt file.
+    bool next(EventsScanner::EventView &event);
+};
+
+// Converts the events file at json_path into an .evb file at evb_path; returns the number of events
+uint64_t convertEventsFile(const std::string &json_path, const std::string &evb_path);
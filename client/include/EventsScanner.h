@@ -0,0 +1,87 @@
+#pragma once
+
+#include "event.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A file mapped read-only into memory, unmapped again on destruction
+class MappedFile {
+private:
+    const char *address;
+    size_t length;
+
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    std::string_view data() const { return std::string_view(address, length); }
+};
+
+// Reads events files laid out the way ours are:
+//   {"team a": "...", "team b": "...", "events": [{"event name": "...", "time": 0,
+//    "general game updates": {...}, "team a updates": {...}, "team b updates": {...}, "description": "..."}, ...]}
+// Everything it returns points into the json it was given; nothing is copied or unescaped.
+// It only accepts what it can return that way: update values that are strings, integers, true,
+// false or null, strings without escapes, no other keys, and the team names before the events.
+// Anything else is a MISMATCH, and the file has to be read with the generic parser.
+class EventsScanner {
+public:
+    typedef std::vector<std::pair<std::string_view, std::string_view>> Updates;
+
+    // One element of "events". Non-string update values are their json text, as dump() writes them.
+    struct EventView {
+        std::string_view name;
+        int time;
+        Updates game_updates;
+        Updates team_a_updates;
+        Updates team_b_updates;
+        std::string_view description;
+
+        EventView();
+        Event toEvent(const std::string &team_a_name, const std::string &team_b_name) const;
+    };
+
+    enum class Status { EVENT, END, MISMATCH };
+
+private:
+    std::string_view json;
+    size_t pos;
+    std::string_view team_a_name;
+    std::string_view team_b_name;
+    bool firstEvent;
+
+    void skipSpace();
+    bool consume(char c);
+    bool string(std::string_view &out);
+    bool literal(std::string_view &out);
+    bool integer(std::string_view &out);
+    bool updates(Updates &out);
+    Status separator();
+    bool readEvent(EventView &event);
+    bool skipObject(std::string_view &object);
+
+public:
+    explicit EventsScanner(std::string_view json);
+
+    // Reads the root object up to the first event. Returns false on a MISMATCH.
+    bool start();
+    std::string_view teamA() const { return team_a_name; }
+    std::string_view teamB() const { return team_b_name; }
+
+    // Reads the next event into event. END once the array and the root object closed
+    // with nothing but whitespace after them.
+    Status next(EventView &event);
+
+    // Like next(), but only finds where the next event starts and ends, for parsing it later,
+    // or elsewhere, with parseEvent(). Checks no more than the brackets are balanced.
+    Status nextObject(std::string_view &object);
+
+    // Reads one event from the text nextObject() returned. Returns false on a MISMATCH.
+    static bool parseEvent(std::string_view object, EventView &event);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <sys/types.h>
+
+// Follows a file that another process keeps appending lines to, like tail -f, with inotify:
+// readLines() hands out every complete line written since the last call, and wait() sleeps
+// until more is written. Each line is handed out once, and only once its '\n' has been written.
+// If the file is truncated it is read again from the start, also when it has since grown past
+// where reading had got to; if another file takes its place it is gone.
+class FeedFollower {
+public:
+    enum class Wake {
+        DATA,     // the file was written to
+        STOPPED,  // the stop descriptor became readable, or hung up
+        GONE      // the file was deleted or moved away
+    };
+
+private:
+    std::string path;
+    int fd;
+    int inotifyFd;
+    off_t offset;         // bytes of the file handed out so far, or held in pending
+    std::string pending;  // the start of a line whose '\n' has not been written yet
+    std::string before;   // the last bytes before offset, to notice the file was rewritten
+
+    // How many of the bytes before offset are kept to compare
+    static constexpr size_t FINGERPRINT_BYTES = 64;
+
+    // The (up to FINGERPRINT_BYTES) bytes of the file just before offset
+    std::string bytesBeforeOffset() const;
+    bool readAvailable(const std::function<bool(std::string_view)> &onLine);
+
+public:
+    // Opens path and starts watching it. Throws std::runtime_error if it cannot.
+    explicit FeedFollower(const std::string &path);
+    FeedFollower(const FeedFollower &) = delete;
+    FeedFollower &operator=(const FeedFollower &) = delete;
+    ~FeedFollower();
+
+    // Hands the lines appended since the last call to onLine, in order and without their '\n'.
+    // Returns false as soon as onLine does; the next call starts with the line after that one.
+    bool readLines(const std::function<bool(std::string_view)> &onLine);
+
+    // Blocks until the file changes or stopFd (-1 for none) is readable. The file is gone once it
+    // is deleted or moved away, or the path names another file
+    Wake wait(int stopFd);
+};
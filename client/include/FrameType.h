@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <stdexcept>
 
 enum class FrameType {
@@ -12,33 +13,73 @@ enum class FrameType {
     DISCONNECT,
     MESSAGE,
     RECEIPT,
-    ERROR
+    ERROR,
+    ACK,
+    NACK,
+    BEGIN,
+    COMMIT,
+    ABORT,
+    STOMP
 };
 
-inline std::string frameTypeToString(FrameType type) {
-    switch (type) {
-        case FrameType::CONNECT: return "CONNECT";
-        case FrameType::CONNECTED: return "CONNECTED";
-        case FrameType::SEND: return "SEND";
-        case FrameType::SUBSCRIBE: return "SUBSCRIBE";
-        case FrameType::UNSUBSCRIBE: return "UNSUBSCRIBE";
-        case FrameType::DISCONNECT: return "DISCONNECT";
-        case FrameType::MESSAGE: return "MESSAGE";
-        case FrameType::RECEIPT: return "RECEIPT";
-        case FrameType::ERROR: return "ERROR";
-        default: throw std::runtime_error("Unknown frame type");
+// Command names, indexed by FrameType
+inline constexpr std::string_view FRAME_TYPE_NAMES[] = {
+    "CONNECT", "CONNECTED", "SEND", "SUBSCRIBE", "UNSUBSCRIBE", "DISCONNECT", "MESSAGE", "RECEIPT", "ERROR",
+    "ACK", "NACK", "BEGIN", "COMMIT", "ABORT", "STOMP"
+};
+
+inline constexpr size_t FRAME_TYPE_COUNT = sizeof(FRAME_TYPE_NAMES) / sizeof(FRAME_TYPE_NAMES[0]);
+
+constexpr std::string_view frameTypeToString(FrameType type) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= FRAME_TYPE_COUNT) {
+        throw std::runtime_error("Unknown frame type");
     }
+    return FRAME_TYPE_NAMES[index];
 }
 
-inline FrameType stringToFrameType(const std::string& str) {
-    if (str == "CONNECT") return FrameType::CONNECT;
-    if (str == "CONNECTED") return FrameType::CONNECTED;
-    if (str == "SEND") return FrameType::SEND;
-    if (str == "SUBSCRIBE") return FrameType::SUBSCRIBE;
-    if (str == "UNSUBSCRIBE") return FrameType::UNSUBSCRIBE;
-    if (str == "DISCONNECT") return FrameType::DISCONNECT;
-    if (str == "MESSAGE") return FrameType::MESSAGE;
-    if (str == "RECEIPT") return FrameType::RECEIPT;
-    if (str == "ERROR") return FrameType::ERROR;
-    throw std::runtime_error("Unknown frame type: " + str);
-}
\ No newline at end of file
+// The length and first byte leave at most one candidate, so a command costs one comparison
+constexpr FrameType stringToFrameType(std::string_view str) {
+    FrameType candidate = FrameType::ERROR;
+    bool found = true;
+    char first = str.empty() ? '\0' : str[0];
+    switch (str.size()) {
+        case 3: candidate = FrameType::ACK; break;
+        case 4: candidate = first == 'S' ? FrameType::SEND : FrameType::NACK; break;
+        case 5:
+            switch (first) {
+                case 'B': candidate = FrameType::BEGIN; break;
+                case 'A': candidate = FrameType::ABORT; break;
+                case 'S': candidate = FrameType::STOMP; break;
+                default: candidate = FrameType::ERROR; break;
+            }
+            break;
+        case 6: candidate = FrameType::COMMIT; break;
+        case 7:
+            switch (first) {
+                case 'C': candidate = FrameType::CONNECT; break;
+                case 'M': candidate = FrameType::MESSAGE; break;
+                default: candidate = FrameType::RECEIPT; break;
+            }
+            break;
+        case 9: candidate = first == 'C' ? FrameType::CONNECTED : FrameType::SUBSCRIBE; break;
+        case 10: candidate = FrameType::DISCONNECT; break;
+        case 11: candidate = FrameType::UNSUBSCRIBE; break;
+        default: found = false; break;
+    }
+    if (!found || FRAME_TYPE_NAMES[static_cast<size_t>(candidate)] != str) {
+        throw std::runtime_error("Unknown frame type: " + std::string(str));
+    }
+    return candidate;
+}
+
+// Both directions of the table agree for every command
+constexpr bool frameTypeTablesAgree() {
+    for (size_t i = 0; i < FRAME_TYPE_COUNT; i++) {
+        if (stringToFrameType(FRAME_TYPE_NAMES[i]) != static_cast<FrameType>(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(frameTypeTablesAgree(), "FrameType lookup tables are out of sync");
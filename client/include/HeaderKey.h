@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Headers the client looks up on every frame. Frames keep these in fixed slots,
+// everything else (OTHER) in a list.
+enum class HeaderKey {
+    DESTINATION,
+    SUBSCRIPTION,
+    MESSAGE_ID,
+    RECEIPT_ID,
+    RECEIPT,
+    CONTENT_LENGTH,
+    ID,
+    BATCH_COUNT,
+    OTHER
+};
+
+// Number of slotted headers
+constexpr size_t KNOWN_HEADER_COUNT = static_cast<size_t>(HeaderKey::OTHER);
+
+inline const std::string& headerKeyToString(HeaderKey key) {
+    static const std::string names[KNOWN_HEADER_COUNT + 1] = {
+        "destination", "subscription", "message-id", "receipt-id", "receipt", "content-length", "id",
+        "batch-count", ""
+    };
+    return names[static_cast<size_t>(key)];
+}
+
+inline HeaderKey stringToHeaderKey(std::string_view str) {
+    // The length tells most of them apart before comparing any bytes
+    switch (str.size()) {
+        case 2:
+            if (str == "id") return HeaderKey::ID;
+            break;
+        case 7:
+            if (str == "receipt") return HeaderKey::RECEIPT;
+            break;
+        case 10:
+            if (str == "message-id") return HeaderKey::MESSAGE_ID;
+            if (str == "receipt-id") return HeaderKey::RECEIPT_ID;
+            break;
+        case 11:
+            if (str == "destination") return HeaderKey::DESTINATION;
+            if (str == "batch-count") return HeaderKey::BATCH_COUNT;
+            break;
+        case 12:
+            if (str == "subscription") return HeaderKey::SUBSCRIPTION;
+            break;
+        case 14:
+            if (str == "content-length") return HeaderKey::CONTENT_LENGTH;
+            break;
+    }
+    return HeaderKey::OTHER;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// A minimal io_uring instance driven through the raw syscalls (no liburing).
+// Every call submits its SQEs with a single io_uring_enter and blocks until they complete,
+// so one ring must only be used by one thread at a time.
+class IoUring {
+private:
+	int ringFd_;
+
+	void *sqRing_;
+	size_t sqRingSize_;
+	void *cqRing_;
+	size_t cqRingSize_;
+	io_uring_sqe *sqes_;
+	size_t sqesSize_;
+
+	unsigned *sqHead_;
+	unsigned *sqTail_;
+	unsigned *sqMask_;
+	unsigned *sqArray_;
+	unsigned *cqHead_;
+	unsigned *cqTail_;
+	unsigned *cqMask_;
+	io_uring_cqe *cqes_;
+
+	bool buffersRegistered_;
+	std::bitset<256> supportedOps_;  // by opcode, as reported by IORING_REGISTER_PROBE
+
+	IoUring(const IoUring &);
+	IoUring &operator=(const IoUring &);
+
+	// Reserve the next submission queue entry (zeroed).
+	io_uring_sqe *nextSqe();
+	// Submit the prepared entries and wait for `count` completions; results go to results[].
+	bool submitAndWait(unsigned count, int results[]);
+	// Ask the kernel which opcodes it implements.
+	void probe();
+
+public:
+	explicit IoUring(unsigned entries);
+
+	~IoUring();
+
+	// False if the kernel refused to set up the ring (too old, seccomp, ...).
+	bool isAvailable() const;
+
+	// Whether the kernel implements the opcode. Always false before Linux 5.6, which has no probe
+	// (nor IORING_OP_READ).
+	bool supports(unsigned char opcode) const;
+
+	// Register buffers for READ_FIXED; buffer i is then addressed by index i.
+	bool registerBuffers(const struct iovec *buffers, unsigned count);
+
+	// Read up to len bytes. A registered buffer is used with READ_FIXED when bufferIndex >= 0.
+	// Returns the number of bytes read, 0 on end of file or -errno.
+	int read(int fd, char *buf, size_t len, int bufferIndex = -1);
+
+	// Gathered write of the whole iovec array (split into linked batches of IOV_MAX entries).
+	// Returns the number of bytes written or -errno.
+	long writev(int fd, const struct iovec *iov, unsigned count);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+// SENDs published by report whose RECEIPT has not arrived yet, keyed by receipt-id.
+// The main thread adds to it and only blocks while the window is full; the listener
+// retires receipts in whatever order the server sends them.
+//
+// The limit is either fixed or adaptive. Adaptive sizing works like TCP Vegas: the lowest
+// round trip seen is taken as the path without queueing, and once per round
+// limit * (1 - baseRtt / rtt) estimates how many SENDs sit queued at the server. The window
+// doubles while that stays under one (slow start), then grows by one while it is under
+// QUEUE_LOW and shrinks by one above QUEUE_HIGH, halving if the queue reaches half of a large window.
+// It only grows after rounds in which it was actually full.
+class ReceiptWindow {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr size_t DEFAULT_LIMIT = 32;
+    static constexpr size_t MIN_LIMIT = 1;
+    static constexpr size_t MAX_LIMIT = 1024;
+    static constexpr size_t INITIAL_ADAPTIVE_LIMIT = 4;
+    static constexpr double QUEUE_LOW = 2;
+    static constexpr double QUEUE_HIGH = 4;
+
+private:
+    std::unordered_map<long, Clock::time_point> outstanding;  // receipt-id -> time sent
+    size_t limit;
+    bool closed;  // connection lost, nothing more will be retired
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // adaptive sizing
+    bool adaptive;
+    bool slowStart;
+    Clock::duration baseRtt;      // lowest RTT on this connection, zero until measured
+    Clock::duration roundMinRtt;  // lowest RTT in the current round, zero until measured
+    size_t roundAcks;             // receipts in the current round; a round is one window's worth
+    bool roundFilled;             // the window was full during the round, so growing it can help
+
+    void onRtt(Clock::duration rtt);
+
+public:
+    explicit ReceiptWindow(size_t limit = DEFAULT_LIMIT);
+
+    // Keep the limit at limit (at least 1)
+    void setLimit(size_t limit);
+    // Size the limit from measured round trips, continuing from what this connection learned
+    void setAdaptive();
+    size_t getLimit();
+    // Lowest round trip measured on this connection (zero if none yet)
+    Clock::duration getBaseRtt();
+
+    // Wait for room in the window, then record receiptId as sent now. Call before sending,
+    // so the receipt cannot arrive first. Returns false if the window was closed.
+    bool acquire(long receiptId);
+
+    // A RECEIPT arrived. Returns false if receiptId is not in the window.
+    bool retire(std::string_view receiptId);
+
+    // Wait until every outstanding receipt arrived. Returns false if the window was closed first.
+    bool drain();
+
+    // The connection is gone: wake up waiters and forget what is outstanding.
+    void close();
+
+    // Start over for a new connection.
+    void reset();
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What report sends for an events file, kept so reporting the same unchanged file again skips
+// reading it and building the bodies. An entry belongs to one version of one file as one user:
+// the key holds the file's size and modification time, and the bodies carry the user's name.
+//
+// Entries live in memory up to a byte budget, least recently used first out. With a directory
+// set they are also written there, one file per path and user, and read back on a miss, so they
+// survive restarts. Only the main thread uses the cache.
+class ReportCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+    struct Key {
+        std::string path;   // absolute
+        uint64_t size;
+        int64_t mtime;      // nanoseconds since the epoch
+        std::string user;
+
+        Key() : path(), size(0), mtime(0), user() {}
+        bool operator<(const Key& other) const;
+        bool operator==(const Key& other) const;
+    };
+
+    struct Entry {
+        std::string teamA;
+        std::string teamB;
+        std::vector<std::string> bodies;  // one SEND body per event, in file order
+
+        Entry() : teamA(), teamB(), bodies() {}
+        size_t bytes() const;
+    };
+
+private:
+    struct Slot {
+        std::shared_ptr<const Entry> entry;
+        size_t bytes;
+        uint64_t lastUse;
+
+        Slot(std::shared_ptr<const Entry> entry, size_t bytes, uint64_t lastUse)
+            : entry(entry), bytes(bytes), lastUse(lastUse) {}
+    };
+
+    std::map<Key, Slot> slots;
+    size_t budget;
+    size_t used;
+    uint64_t uses;
+    std::string directory;  // empty when entries are kept in memory only
+
+    void keep(const Key& key, std::shared_ptr<const Entry> entry, size_t bytes);
+    std::string fileFor(const Key& key) const;
+    std::shared_ptr<const Entry> load(const Key& key) const;
+    bool save(const Key& key, const Entry& entry) const;
+
+public:
+    explicit ReportCache(size_t budget = DEFAULT_BUDGET);
+
+    // Persist entries in dir, creating it if needed. Returns false (staying in memory only) if it cannot.
+    bool setDirectory(const std::string& dir);
+    size_t getBudget() const { return budget; }
+
+    // The key for the file at path as it is now. Returns false if the file cannot be stat'ed.
+    static bool keyFor(const std::string& path, const std::string& user, Key& key);
+
+    // The entry for key, from memory or from the directory; null on a miss
+    std::shared_ptr<const Entry> find(const Key& key);
+
+    // Keep entry for key (in memory if it fits the budget, and in the directory if one is set)
+    void store(const Key& key, std::shared_ptr<const Entry> entry);
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "FrameType.h"
+#include "HeaderKey.h"
 #include <string>
 #include <vector>
 
@@ -10,30 +11,61 @@ public:
     struct Header {
         std::string key;
         std::string value;
-        
+
         Header(const std::string& k, const std::string& v) : key(k), value(v) {}
     };
 
 private:
     FrameType type;
-    std::vector<Header> headers;
+    std::string known[KNOWN_HEADER_COUNT];  // values of the well-known headers, see knownMask
+    unsigned knownMask;                     // bit i set when known[i] holds a header
+    std::vector<Header> headers;            // all other headers (and repeats of known ones)
     std::string body;
 
+    // First occurrence of a well-known header goes to its slot, the rest to the list
+    void addHeader(HeaderKey id, const std::string& key, const std::string& value);
+
 public:
     // Constructor with parameters
     StompFrame(FrameType type, const std::string& body, const std::vector<Header>& headers);
-    
+
     // Constructor for parsing from string
     StompFrame(const std::string& rawFrame);
-    
+
     // Convert frame to string (for sending)
     std::string toString() const;
-    
+
+    // Bytes appendTo() writes
+    size_t serializedSize() const;
+
+    // Append the frame as sent, including its '\0', to out. Reusing out across frames makes this
+    // allocation free once out has grown to the largest frame.
+    void appendTo(std::string& out) const;
+
     // Getters
     FrameType getType() const;
     const std::string& getBody() const;
+
+    // The headers that have no slot
     const std::vector<Header>& getHeaders() const;
-    
-    // Get header value by key
-    std::string getHeaderValue(const std::string& key) const;
-};
\ No newline at end of file
+
+    // Call f(key, value) for every header, slotted ones first
+    template <typename F>
+    void forEachHeader(F f) const {
+        for (size_t i = 0; i < KNOWN_HEADER_COUNT; i++) {
+            if (knownMask & (1u << i)) {
+                f(headerKeyToString(static_cast<HeaderKey>(i)), known[i]);
+            }
+        }
+        for (const auto& header : headers) {
+            f(header.key, header.value);
+        }
+    }
+
+    // Get a well-known header's value (empty if missing)
+    const std::string& getHeaderValue(HeaderKey key) const;
+    bool hasHeader(HeaderKey key) const;
+
+    // Get header value by key (empty if missing)
+    const std::string& getHeaderValue(const std::string& key) const;
+};
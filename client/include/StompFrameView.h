@@ -0,0 +1,67 @@
+#pragma once
+
+#include "FrameType.h"
+#include "StompFrame.h"
+#include "StompParser.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// A received frame parsed in place: command, headers and body are views into the
+// receive buffer, which the frame keeps alive. Nothing is copied until toFrame().
+class StompFrameView
+{
+public:
+    struct HeaderView {
+        std::string_view key;
+        std::string_view value;
+    };
+
+private:
+    FrameType type;
+    std::string_view known[KNOWN_HEADER_COUNT];  // well-known headers, see knownMask
+    unsigned knownMask;                          // bit i set when known[i] holds a header
+    std::vector<HeaderView> headers;             // all other headers (and repeats of known ones)
+    std::string_view body;
+    std::shared_ptr<const void> storage;
+
+    void assign(std::string_view frame, const StompParser::Result& parsed);
+
+public:
+    // Parse rawFrame (without its '\0'); storage owns the bytes rawFrame points into
+    StompFrameView(std::string_view rawFrame, std::shared_ptr<const void> storage);
+
+    // Build from what a StompParser already found in rawFrame, without parsing again
+    StompFrameView(std::string_view rawFrame, const StompParser::Result& parsed,
+                   std::shared_ptr<const void> storage);
+
+    // Getters
+    FrameType getType() const;
+    std::string_view getBody() const;
+
+    // The headers that have no slot
+    const std::vector<HeaderView>& getHeaders() const;
+
+    // Call f(key, value) for every header, slotted ones first
+    template <typename F>
+    void forEachHeader(F f) const {
+        for (size_t i = 0; i < KNOWN_HEADER_COUNT; i++) {
+            if (knownMask & (1u << i)) {
+                f(std::string_view(headerKeyToString(static_cast<HeaderKey>(i))), known[i]);
+            }
+        }
+        for (const auto& header : headers) {
+            f(header.key, header.value);
+        }
+    }
+
+    // Get a well-known header's value (empty if missing)
+    std::string_view getHeaderValue(HeaderKey key) const;
+    bool hasHeader(HeaderKey key) const;
+
+    // Get header value by key (empty if missing)
+    std::string_view getHeaderValue(std::string_view key) const;
+
+    // Copy into an owning StompFrame, for consumers that keep the frame
+    StompFrame toFrame() const;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "FrameType.h"
+#include "HeaderKey.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Resumable STOMP frame parser. It is handed the bytes buffered so far for the current
+// frame (always starting at the frame's first byte, growing between calls) and remembers
+// how far it got, so a frame arriving over many reads is scanned only once.
+// A content-length header frames the body by length: embedded NULs are allowed and the
+// body is skipped without being scanned.
+class StompParser
+{
+public:
+    // Position of a piece of the frame, relative to the frame's first byte.
+    struct Range {
+        size_t offset;
+        size_t length;
+
+        std::string_view in(std::string_view frame) const { return frame.substr(offset, length); }
+    };
+
+    struct HeaderRange {
+        Range key;
+        Range value;
+        HeaderKey id;  // which slot the header belongs in, OTHER if none
+    };
+
+    // A complete frame, valid until the next call to parse().
+    struct Result {
+        FrameType type;
+        std::vector<HeaderRange> headers;
+        Range body;
+        size_t length;  // bytes the frame took, including its '\0'
+
+        Result() : type(FrameType::ERROR), headers(), body{0, 0}, length(0) {}
+    };
+
+private:
+    enum class State { COMMAND, HEADERS, BODY, DONE };
+
+    State state;
+    size_t scanned;     // bytes of the current frame already looked at
+    size_t lineStart;
+    size_t lineColon;   // first ':' of the current line, if seen
+    size_t contentLength;
+    Result result;
+
+    void reset();
+
+public:
+    static constexpr size_t UNKNOWN_LENGTH = static_cast<size_t>(-1);
+
+    StompParser();
+
+    // Continue parsing the current frame. Returns the frame's length (including its '\0')
+    // once it is complete, or 0 if more bytes are needed.
+    // With endOfInput the end of data counts as the terminator (for frames already cut out).
+    // Throws std::runtime_error on an unknown command, a malformed content-length header or a
+    // body that does not end at its content-length.
+    size_t parse(std::string_view data, bool endOfInput = false);
+
+    // The frame completed by the last parse() call.
+    const Result& frame() const;
+};
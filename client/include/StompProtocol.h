@@ -1,10 +1,50 @@
 #pragma once
 
 #include "../include/ConnectionHandler.h"
+#include "../include/StompFrame.h"
 
-// TODO: implement the STOMP protocol
+#include <map>
+#include <string>
+
+// Builds the frames the client sends, and keeps track of a session's login and subscriptions.
+// The builders need no session, so they are static.
 class StompProtocol
 {
 private:
+    int nextReceiptId;
+    int nextSubscriptionId;
+    bool isLoggedIn;
+    std::string currentUser;
+    std::map<std::string, std::string> gameToSubscriptionId;
+
 public:
+    StompProtocol();
+    ~StompProtocol();
+
+    static StompFrame buildConnectFrame(const std::string& host, const std::string& user, const std::string& passcode);
+    // filename, receiptId and transactionId are left out when empty
+    static StompFrame buildSendFrame(const std::string& destination, const std::string& body, const std::string& filename,
+                                     const std::string& receiptId, const std::string& transactionId = "");
+    static StompFrame buildBeginFrame(const std::string& transactionId);
+    // the server acknowledges the whole transaction with receiptId's RECEIPT
+    static StompFrame buildCommitFrame(const std::string& transactionId, const std::string& receiptId);
+    static StompFrame buildSubscribeFrame(const std::string& destination, const std::string& subscriptionId);
+    static StompFrame buildUnsubscribeFrame(const std::string& subscriptionId);
+    static StompFrame buildDisconnectFrame(const std::string& receiptId);
+
+    void setLoggedIn(bool logged, const std::string& user);
+    bool getLoggedIn() const;
+    std::string getCurrentUser() const;
+
+    void addSubscription(const std::string& game, const std::string& subscriptionId);
+    void removeSubscription(const std::string& game);
+    std::string getSubscriptionId(const std::string& game) const;
+    bool isSubscribedTo(const std::string& game) const;
+    void clearAllSubscriptions();
+
+    std::string getNextReceiptId();
+    std::string getNextSubscriptionId();
+
+    bool validateConnectResponse(const StompFrame& frame) const;
+    bool validateMessageFrame(const StompFrame& frame) const;
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Finds the structural characters of frames and event bodies ('\n', ':' and '\0') a 64 byte
+// block at a time and hands out their positions in order. A block is turned into a bitmap
+// with AVX2 or SSE2 when the CPU has them (picked at startup), or byte by byte otherwise.
+class StructuralScanner
+{
+public:
+    enum class Isa { SCALAR, SSE2, AVX2 };
+
+    static constexpr size_t BLOCK_BYTES = 64;
+    static constexpr size_t npos = std::string_view::npos;
+
+private:
+    std::string_view data;
+    size_t blockStart;  // data offset of bit 0
+    uint64_t bits;      // structural characters of the current block not handed out yet
+
+    void load(size_t start);
+
+public:
+    // Scan data starting at from
+    StructuralScanner(std::string_view data, size_t from = 0);
+
+    // Position of the next structural character, or npos at the end of data
+    size_t next();
+
+    // Bit i is set when block[i] is structural; block must have BLOCK_BYTES readable bytes
+    static uint64_t scanBlock(const char *block);
+
+    static Isa getIsa();
+    // Use isa if the CPU supports it (e.g. to compare implementations); returns the one in use
+    static Isa setIsa(Isa isa);
+    static const char *isaName(Isa isa);
+};
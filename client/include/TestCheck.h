@@ -0,0 +1,24 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the client's test programs: a failed CHECK prints where and what, and
+// testResult() turns the count of failures into the program's exit status.
+static int testFailures = 0;
+
+#define CHECK(condition)                                                                            \
+    do {                                                                                            \
+        if (!(condition)) {                                                                         \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << std::endl; \
+            testFailures++;                                                                         \
+        }                                                                                           \
+    } while (false)
+
+// ends main: prints a summary line and returns 0 if every check passed, 1 otherwise
+static int testResult(const char *name) {
+    if (testFailures == 0)
+        std::cout << name << ": all checks passed" << std::endl;
+    else
+        std::cerr << name << ": " << testFailures << " checks failed" << std::endl;
+    return testFailures == 0 ? 0 : 1;
+}
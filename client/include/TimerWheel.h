@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// A hierarchical timing wheel (as in the Linux kernel's timer lists): LEVELS wheels of SLOTS
+// slots each, the first one tick per slot, every next one SLOTS times coarser. A timer is put
+// in the finest wheel its delay fits in, and timers of a coarser slot move down a level when
+// the finer wheel comes round to them, so adding and firing a timer take constant time however
+// many are pending. Delays past the last wheel are kept at its far end and placed again later.
+//
+// Time is counted in ticks from 0; what a tick is, and the clock, are up to the caller.
+// Timers due on the same tick fire in the order they were added. Not thread safe.
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t SLOTS = uint64_t(1) << SLOT_BITS;
+
+private:
+    struct Timer {
+        uint64_t expiry;    // tick it is due on
+        uint64_t id;
+        uint64_t sequence;  // order it was added in, so timers due together fire in that order
+    };
+
+    std::vector<std::vector<Timer>> slots;  // LEVELS * SLOTS, the finest wheel first
+    uint64_t current;                       // next tick to run; everything earlier has fired
+    size_t pending;
+    uint64_t added;                         // timers scheduled so far
+
+    void place(const Timer &timer);
+    void cascade(unsigned level);
+
+public:
+    TimerWheel();
+
+    // Fire id on tick expiry, or on the next tick run if expiry has passed
+    void schedule(uint64_t expiry, uint64_t id);
+
+    // Runs every tick up to and including tick, calling onFire(id, expiry) for each timer due
+    void advance(uint64_t tick, const std::function<void(uint64_t, uint64_t)> &onFire);
+
+    // A tick no later than the next timer is due: exactly that tick when it is in the finest
+    // wheel, otherwise the tick on which the finest wheel wraps round and timers move down
+    uint64_t nextDeadline() const;
+
+    bool empty() const { return pending == 0; }
+    size_t size() const { return pending; }
+};
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <map>
 #include <vector>
+#include <functional>
 
 class Event
 {
@@ -27,7 +29,7 @@ private:
 
 public:
     Event(std::string name, std::string team_a_name, std::string team_b_name, int time, std::map<std::string, std::string> game_updates, std::map<std::string, std::string> team_a_updates, std::map<std::string, std::string> team_b_updates, std::string description);
-    Event(const std::string & frame_body);
+    Event(std::string_view frame_body);
     virtual ~Event();
     const std::string &get_team_a_name() const;
     const std::string &get_team_b_name() const;
@@ -44,7 +46,33 @@ struct names_and_events {
     std::string team_a_name;
     std::string team_b_name;
     std::vector<Event> events;
+
+    names_and_events() : team_a_name(), team_b_name(), events() {}
 };
 
-// function that parses the json file and returns a names_and_events object
-names_and_events parseEventsFile(std::string json_path);
+// function that parses the json file and returns a names_and_events object.
+// With threads > 1 the events are converted on that many threads, each taking a contiguous
+// range of the events array; 0 means one per core. The events keep their file order.
+names_and_events parseEventsFile(std::string json_path, size_t threads = 1);
+
+// streaming version: reads the json file with a SAX parser and hands the events to onEvent one at
+// a time, in file order, so only the event being read is kept in memory (as long as the team names
+// come before the events). onNames is called once with the team names, before the first event.
+// Returns false if onEvent returned false to stop early.
+// Files laid out like ours are read from a mapping by EventsScanner, anything else by the generic
+// parser below; either way the same events come out. .evb files made by EvbConverter (see
+// EventBinary.h) are read from a mapping without any json parsing.
+bool parseEventsFile(const std::string &json_path,
+                     const std::function<void(const std::string &, const std::string &)> &onNames,
+                     const std::function<bool(Event &&)> &onEvent);
+
+// the same, always with nlohmann's SAX parser
+bool parseEventsFileGeneric(const std::string &json_path,
+                            const std::function<void(const std::string &, const std::string &)> &onNames,
+                            const std::function<bool(Event &&)> &onEvent);
+
+// One line of an NDJSON feed: an event object like the elements of "events", optionally with
+// "team a" and "team b". Names on a line set team_a_name and team_b_name for it and the lines
+// after it. Returns false, leaving event alone, for a line with only the names.
+// Throws std::runtime_error if the line is not such an object.
+bool parseEventLine(std::string_view line, std::string &team_a_name, std::string &team_b_name, Event &event);
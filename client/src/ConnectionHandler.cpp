@@ -1,5 +1,11 @@
 #include "../include/ConnectionHandler.h"
 
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <netinet/tcp.h>
+
 using boost::asio::ip::tcp;
 
 using std::cin;
@@ -8,19 +14,119 @@ using std::cerr;
 using std::endl;
 using std::string;
 
-ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port), io_service_(),
-                                                                socket_(io_service_) {}
+const string ConnectionHandler::UNIX_PREFIX = "unix:";
+
+ConnectionHandler::ConnectionHandler(string host, unsigned short port, const SocketOptions &options, Transport transport)
+		: ConnectionHandler(ownService_, host, port, options, transport) {}
+
+ConnectionHandler::ConnectionHandler(boost::asio::io_service &io_service, string host, unsigned short port,
+                                     const SocketOptions &options, Transport transport)
+		: host_(host), port_(port), local_(host.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0),
+		  socketOptions_(options), transport_(transport), ownService_(), io_service_(io_service), socket_(io_service_),
+		  strand_(io_service_), inSlab_(std::make_shared<std::vector<char>>(RECEIVE_CHUNK)), inStart_(0),
+		  inEnd_(0), asyncMode_(false), splitter_(), onFrame_(), onClose_(), writeQueue_(), writing_(false),
+		  inFlight_(), writeBuffers_(), flushPolicy_(), queuedBytes_(0), flushDue_(false), timerArmed_(false), timerGeneration_(0),
+		  flushTimer_(io_service_), work_(), asyncMtx_(), staged_(), drainPosted_(false), freeWrites_(),
+		  stagedMtx_(), readRing_(), writeRing_(), registeredSlab_(), loopStopped_(false) {
+	if (transport_ == Transport::IO_URING)
+		setUpIoUring();
+}
+
+void ConnectionHandler::setUpIoUring() {
+	readRing_.reset(new IoUring(RING_ENTRIES));
+	writeRing_.reset(new IoUring(RING_ENTRIES));
+	// The opcodes used are probed, since a ring may set up on a kernel that lacks some of them.
+	if (!readRing_->isAvailable() || !writeRing_->isAvailable() || !readRing_->supports(IORING_OP_READ) ||
+	    !writeRing_->supports(IORING_OP_WRITEV)) {
+		std::cerr << "io_uring unavailable, falling back to the boost transport" << std::endl;
+		readRing_.reset();
+		writeRing_.reset();
+		transport_ = Transport::BOOST;
+		return;
+	}
+	// The first slab is pinned once for READ_FIXED and kept for as long as the ring lives.
+	// If pinning is refused (RLIMIT_MEMLOCK), or READ_FIXED is missing, reads simply go through plain READ.
+	if (!readRing_->supports(IORING_OP_READ_FIXED))
+		return;
+	struct iovec receive;
+	receive.iov_base = inSlab_->data();
+	receive.iov_len = inSlab_->size();
+	if (readRing_->registerBuffers(&receive, 1))
+		registeredSlab_ = inSlab_;
+}
+
+ConnectionHandler::Transport ConnectionHandler::getTransport() const {
+	return transport_;
+}
+
+size_t ConnectionHandler::readSome(char *buf, size_t len, boost::system::error_code &error) {
+	if (!readRing_)
+		return socket_.read_some(boost::asio::buffer(buf, len), error);
+	bool fixed = registeredSlab_ && buf >= registeredSlab_->data() &&
+	             buf + len <= registeredSlab_->data() + registeredSlab_->size();
+	int result = readRing_->read(socket_.native_handle(), buf, len, fixed ? 0 : -1);
+	if (result < 0)
+		error = boost::system::error_code(-result, boost::system::system_category());
+	else if (result == 0)
+		error = boost::asio::error::eof;
+	return result > 0 ? static_cast<size_t>(result) : 0;
+}
+
+bool ConnectionHandler::ringWrite(const std::vector<boost::asio::const_buffer> &buffers) {
+	std::vector<struct iovec> iov(buffers.size());
+	for (size_t i = 0; i < buffers.size(); i++) {
+		iov[i].iov_base = const_cast<void *>(boost::asio::buffer_cast<const void *>(buffers[i]));
+		iov[i].iov_len = boost::asio::buffer_size(buffers[i]);
+	}
+	// Resume after short writes until every buffer is out.
+	size_t next = 0;
+	while (next < iov.size()) {
+		long written = writeRing_->writev(socket_.native_handle(), iov.data() + next,
+		                                  static_cast<unsigned>(iov.size() - next));
+		if (written < 0) {
+			std::cerr << "send failed (Error: " << std::strerror(static_cast<int>(-written)) << ')' << std::endl;
+			return false;
+		}
+		if (written == 0) {
+			// Nothing accepted at all: the connection is gone, and retrying would spin forever.
+			std::cerr << "send failed (Error: connection closed)" << std::endl;
+			return false;
+		}
+		while (next < iov.size() && static_cast<size_t>(written) >= iov[next].iov_len) {
+			written -= iov[next].iov_len;
+			next++;
+		}
+		if (next < iov.size()) {
+			iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + written;
+			iov[next].iov_len -= written;
+		}
+	}
+	return true;
+}
 
 ConnectionHandler::~ConnectionHandler() {
 	close();
 }
 
 bool ConnectionHandler::connect() {
-	std::cout << "Starting connect to "
-	          << host_ << ":" << port_ << std::endl;
+	if (local_)
+		std::cout << "Starting connect to " << host_ << std::endl;
+	else
+		std::cout << "Starting connect to "
+		          << host_ << ":" << port_ << std::endl;
 	try {
-		tcp::endpoint endpoint(boost::asio::ip::address::from_string(host_), port_); // the server endpoint
+		// the server endpoint
+		boost::asio::generic::stream_protocol::endpoint endpoint = local_
+				? boost::asio::generic::stream_protocol::endpoint(
+						boost::asio::local::stream_protocol::endpoint(host_.substr(UNIX_PREFIX.size())))
+				: boost::asio::generic::stream_protocol::endpoint(
+						tcp::endpoint(boost::asio::ip::address::from_string(host_), port_));
 		boost::system::error_code error;
+		// buffer sizes must be in place before the handshake to affect window scaling
+		socket_.open(endpoint.protocol(), error);
+		if (error)
+			throw boost::system::system_error(error);
+		applySocketOptions();
 		socket_.connect(endpoint, error);
 		if (error)
 			throw boost::system::system_error(error);
@@ -33,12 +139,55 @@ bool ConnectionHandler::connect() {
 }
 
 bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
-	size_t tmp = 0;
+	// Hand out whatever is already buffered before touching the socket.
+	size_t tmp = std::min<size_t>(bytesToRead, inEnd_ - inStart_);
+	std::memcpy(bytes, inSlab_->data() + inStart_, tmp);
+	inStart_ += tmp;
 	boost::system::error_code error;
 	try {
 		while (!error && bytesToRead > tmp) {
-			tmp += socket_.read_some(boost::asio::buffer(bytes + tmp, bytesToRead - tmp), error);
+			tmp += readSome(bytes + tmp, bytesToRead - tmp, error);
+		}
+		if (error)
+			throw boost::system::system_error(error);
+	} catch (std::exception &e) {
+		//std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void ConnectionHandler::prepareSlab() {
+	size_t pending = inEnd_ - inStart_;
+	// The handler's own reference, plus the one pinning the registered slab.
+	long owners = inSlab_ == registeredSlab_ ? 2 : 1;
+	std::shared_ptr<std::vector<char>> target = inSlab_;
+	if (inSlab_.use_count() > owners) {
+		// A frame view still points into this slab, so it must not be overwritten.
+		target = std::make_shared<std::vector<char>>(std::max(RECEIVE_CHUNK, 2 * pending));
+	} else if (pending == inSlab_->size()) {
+		// A single frame fills the whole slab: grow it.
+		target = std::make_shared<std::vector<char>>(2 * pending);
+	}
+	if (target != inSlab_)
+		std::memcpy(target->data(), inSlab_->data() + inStart_, pending);
+	else if (inStart_ > 0)
+		std::memmove(target->data(), target->data() + inStart_, pending);
+	inSlab_ = target;
+	inStart_ = 0;
+	inEnd_ = pending;
+}
+
+bool ConnectionHandler::fillSlab() {
+	prepareSlab();
+	boost::system::error_code error;
+	try {
+		size_t received = 0;
+		while (!error && received == 0) {
+			received = readSome(inSlab_->data() + inEnd_, inSlab_->size() - inEnd_, error);
 		}
+		inEnd_ += received;
+		applyQuickAck();
 		if (error)
 			throw boost::system::system_error(error);
 	} catch (std::exception &e) {
@@ -49,6 +198,8 @@ bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
 }
 
 bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
+	if (asyncMode_ || writeRing_)
+		return sendBuffers(std::vector<boost::asio::const_buffer>(1, boost::asio::buffer(bytes, bytesToWrite)));
 	int tmp = 0;
 	boost::system::error_code error;
 	try {
@@ -64,6 +215,37 @@ bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
 	return true;
 }
 
+bool ConnectionHandler::sendBuffers(const std::vector<boost::asio::const_buffer> &buffers) {
+	if (asyncMode_) {
+		// The caller's buffers stay alive because we block until the event loop wrote them.
+		std::shared_ptr<std::promise<bool>> written = std::make_shared<std::promise<bool>>();
+		std::future<bool> result = written->get_future();
+		std::shared_ptr<PendingWrite> write = std::make_shared<PendingWrite>();
+		write->buffers = buffers;
+		write->done = [written](bool ok) { written->set_value(ok); };
+		write->flush = true;
+		{
+			std::lock_guard<std::mutex> lock(asyncMtx_);
+			if (!work_)
+				return false;  // the event loop is gone, nobody would ever write this
+			enqueueWrite(write);
+		}
+		return result.get();
+	}
+	if (writeRing_)
+		return ringWrite(buffers);
+	boost::system::error_code error;
+	try {
+		boost::asio::write(socket_, buffers, error);
+		if (error)
+			throw boost::system::system_error(error);
+	} catch (std::exception &e) {
+		std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
+		return false;
+	}
+	return true;
+}
+
 bool ConnectionHandler::getLine(std::string &line) {
 	return getFrameAscii(line, '\n');
 }
@@ -74,32 +256,434 @@ bool ConnectionHandler::sendLine(std::string &line) {
 
 
 bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
-	char ch;
-	// Stop when we encounter the null character.
+	// Scan the buffered bytes for the delimiter and only go back to the socket
+	// (one large read_some) once everything buffered has been consumed.
 	// Notice that the null character is not appended to the frame string.
 	try {
-		do {
-			if (!getBytes(&ch, 1)) {
+		while (true) {
+			if (inStart_ == inEnd_ && !fillSlab()) {
 				return false;
 			}
-			if (ch != '\0')
-				frame.append(1, ch);
-		} while (delimiter != ch);
+			const char *begin = inSlab_->data() + inStart_;
+			size_t available = inEnd_ - inStart_;
+			const char *found = static_cast<const char *>(std::memchr(begin, delimiter, available));
+			size_t chunk = found != nullptr ? static_cast<size_t>(found - begin) + 1 : available;
+
+			size_t oldLength = frame.length();
+			frame.append(begin, chunk);
+			inStart_ += chunk;
+			if (frame.find('\0', oldLength) != std::string::npos)
+				frame.erase(std::remove(frame.begin() + oldLength, frame.end(), '\0'), frame.end());
+
+			if (found != nullptr)
+				return true;
+		}
 	} catch (std::exception &e) {
 		//std::cerr << "recv failed2 (Error: " << e.what() << ')' << std::endl;
 		return false;
 	}
-	return true;
+}
+
+ConnectionHandler::FrameSplitter ConnectionHandler::delimiterSplitter(char delimiter) {
+	// Only the bytes appended since the last call are searched.
+	return [delimiter, scanned = size_t(0)](std::string_view pending) mutable -> size_t {
+		const char *found = static_cast<const char *>(
+				std::memchr(pending.data() + scanned, delimiter, pending.size() - scanned));
+		if (found == nullptr) {
+			scanned = pending.size();
+			return 0;
+		}
+		scanned = 0;
+		return static_cast<size_t>(found - pending.data()) + 1;
+	};
+}
+
+bool ConnectionHandler::getFrameView(std::string_view &frame, Slab &slab, char delimiter) {
+	FrameSplitter splitter = delimiterSplitter(delimiter);
+	return getFrameView(frame, slab, splitter);
+}
+
+bool ConnectionHandler::getFrameView(std::string_view &frame, Slab &slab, FrameSplitter &splitter) {
+	// Leave partial frames in place and read more after them, so every frame ends up
+	// contiguous in one slab.
+	while (true) {
+		std::string_view pending(inSlab_->data() + inStart_, inEnd_ - inStart_);
+		size_t length = splitter(pending);
+		if (length > 0) {
+			frame = pending.substr(0, length - 1);
+			slab = inSlab_;
+			inStart_ += length;
+			return true;
+		}
+		if (!fillSlab())
+			return false;
+	}
 }
 
 bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
-	bool result = sendBytes(frame.c_str(), frame.length());
-	if (!result) return false;
-	return sendBytes(&delimiter, 1);
+	// frame and delimiter leave in a single write
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.push_back(boost::asio::buffer(frame));
+	buffers.push_back(boost::asio::buffer(&delimiter, 1));
+	return sendBuffers(buffers);
+}
+
+void ConnectionHandler::startAsyncRead(char delimiter, FrameHandler onFrame, CloseHandler onClose) {
+	startAsyncRead(delimiterSplitter(delimiter), onFrame, onClose);
+}
+
+void ConnectionHandler::startAsyncRead(FrameSplitter splitter, FrameHandler onFrame, CloseHandler onClose) {
+	if (transport_ == Transport::IO_URING) {
+		// run() reads through the ring instead of the asio reactor.
+		splitter_ = splitter;
+		onFrame_ = onFrame;
+		onClose_ = onClose;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(asyncMtx_);
+		work_.reset(new boost::asio::io_service::work(io_service_));
+	}
+	asyncMode_ = true;
+	splitter_ = splitter;
+	onFrame_ = onFrame;
+	onClose_ = onClose;
+
+	// Bytes a blocking read already pulled off the socket stay in the slab for readNext.
+	strand_.post([this]() { readNext(); });
+}
+
+void ConnectionHandler::readNext() {
+	// Hand out every complete frame already buffered before reading again.
+	while (true) {
+		std::string_view pending(inSlab_->data() + inStart_, inEnd_ - inStart_);
+		size_t length;
+		try {
+			length = splitter_(pending);
+		} catch (const std::exception &e) {
+			failAsyncRead(e);
+			return;
+		}
+		if (length == 0)
+			break;
+		inStart_ += length;
+		if (!onFrame_(pending.substr(0, length - 1), inSlab_)) {
+			endAsyncRead();
+			return;
+		}
+	}
+
+	prepareSlab();
+	socket_.async_read_some(boost::asio::buffer(inSlab_->data() + inEnd_, inSlab_->size() - inEnd_), strand_.wrap(
+			[this](const boost::system::error_code &error, size_t received) {
+				if (error) {
+					endAsyncRead();
+					if (error != boost::asio::error::operation_aborted && onClose_)
+						onClose_();
+					return;
+				}
+				applyQuickAck();
+				inEnd_ += received;
+				readNext();
+			}));
+}
+
+void ConnectionHandler::endAsyncRead() {
+	// Let run() return once the writes still in the queue are done.
+	std::lock_guard<std::mutex> lock(asyncMtx_);
+	work_.reset();
+}
+
+void ConnectionHandler::failAsyncRead(const std::exception &error) {
+	cerr << "malformed frame, closing the connection: " << error.what() << endl;
+	endAsyncRead();
+	boost::system::error_code ignored;
+	socket_.close(ignored);
+	if (onClose_)
+		onClose_();
+}
+
+void ConnectionHandler::asyncSendFrameAscii(const std::string &frame, char delimiter) {
+	if (transport_ == Transport::IO_URING) {
+		sendFrameAscii(frame, delimiter);
+		return;
+	}
+	asyncSendSerialized([&frame, delimiter](std::string &out) {
+		out.append(frame);
+		out.append(1, delimiter);
+	});
+}
+
+std::shared_ptr<ConnectionHandler::PendingWrite> ConnectionHandler::takeWrite() {
+	{
+		std::lock_guard<std::mutex> lock(stagedMtx_);
+		if (!freeWrites_.empty()) {
+			std::shared_ptr<PendingWrite> write = std::move(freeWrites_.back());
+			freeWrites_.pop_back();
+			return write;
+		}
+	}
+	std::shared_ptr<PendingWrite> write = std::make_shared<PendingWrite>();
+	write->pooled = true;
+	return write;
+}
+
+void ConnectionHandler::recycleWrite(std::shared_ptr<PendingWrite> &write) {
+	std::shared_ptr<PendingWrite> written = std::move(write);
+	// An unusually large frame is not worth keeping its buffer around for.
+	if (!written->pooled || written->data.capacity() > POOLED_WRITE_BYTES)
+		return;
+	written->data.clear();
+	written->buffers.clear();
+	written->flush = false;
+	std::lock_guard<std::mutex> lock(stagedMtx_);
+	if (freeWrites_.size() < WRITE_POOL_SIZE)
+		freeWrites_.push_back(std::move(written));
+}
+
+void ConnectionHandler::queueOwnedWrite(std::shared_ptr<PendingWrite> write) {
+	write->buffers.push_back(boost::asio::buffer(write->data));
+	if (transport_ == Transport::IO_URING) {
+		sendBuffers(write->buffers);
+		recycleWrite(write);
+		return;
+	}
+	enqueueWrite(std::move(write));
+}
+
+void ConnectionHandler::flush() {
+	strand_.post([this]() {
+		flushDue_ = true;
+		writeNext();
+	});
+}
+
+void ConnectionHandler::setFlushPolicy(const FlushPolicy &policy) {
+	if (policy.mode == FlushPolicy::SIZE_THRESHOLD && policy.deadlineMicros <= 0)
+		throw std::invalid_argument("a size threshold needs a deadline");
+	FlushPolicy accepted = policy;
+	if (accepted.mode == FlushPolicy::DEADLINE && accepted.deadlineMicros <= 0)
+		accepted.mode = FlushPolicy::IMMEDIATE;  // waiting at most no time at all
+	// The queue and its timer belong to the strand; a pending deadline is re-armed under the new policy.
+	strand_.post([this, accepted]() {
+		flushPolicy_ = accepted;
+		if (timerArmed_)
+			cancelFlushTimer();
+		writeNext();
+	});
+}
+
+void ConnectionHandler::setSocketOptions(const SocketOptions &options) {
+	socketOptions_ = options;
+}
+
+void ConnectionHandler::applySocketOptions() {
+	// A rejected option is not fatal, the connection just runs with the kernel default.
+	boost::system::error_code error;
+	if (socketOptions_.sendBufferSize > 0) {
+		socket_.set_option(boost::asio::socket_base::send_buffer_size(socketOptions_.sendBufferSize), error);
+		if (error)
+			std::cerr << "SO_SNDBUF not set (Error: " << error.message() << ')' << std::endl;
+	}
+	if (socketOptions_.receiveBufferSize > 0) {
+		socket_.set_option(boost::asio::socket_base::receive_buffer_size(socketOptions_.receiveBufferSize), error);
+		if (error)
+			std::cerr << "SO_RCVBUF not set (Error: " << error.message() << ')' << std::endl;
+	}
+	if (local_)
+		return;  // the rest only means something for TCP
+	socket_.set_option(tcp::no_delay(socketOptions_.noDelay), error);
+	if (error)
+		std::cerr << "TCP_NODELAY not set (Error: " << error.message() << ')' << std::endl;
+	applyQuickAck();
+#ifdef SO_BUSY_POLL
+	if (socketOptions_.busyPollMicros > 0) {
+		socket_.set_option(boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>(
+				socketOptions_.busyPollMicros), error);
+		if (error)
+			std::cerr << "SO_BUSY_POLL not set (Error: " << error.message() << ')' << std::endl;
+	}
+#endif
+	if (socketOptions_.keepAlive) {
+		socket_.set_option(boost::asio::socket_base::keep_alive(true), error);
+		if (error)
+			std::cerr << "SO_KEEPALIVE not set (Error: " << error.message() << ')' << std::endl;
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+		if (socketOptions_.keepAliveIdle > 0)
+			socket_.set_option(boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPIDLE>(
+					socketOptions_.keepAliveIdle), error);
+		if (socketOptions_.keepAliveInterval > 0)
+			socket_.set_option(boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPINTVL>(
+					socketOptions_.keepAliveInterval), error);
+		if (socketOptions_.keepAliveCount > 0)
+			socket_.set_option(boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPCNT>(
+					socketOptions_.keepAliveCount), error);
+		if (error)
+			std::cerr << "keepalive timings not set (Error: " << error.message() << ')' << std::endl;
+#endif
+	}
+}
+
+void ConnectionHandler::applyQuickAck() {
+#ifdef TCP_QUICKACK
+	if (socketOptions_.quickAck && !local_) {
+		boost::system::error_code error;
+		socket_.set_option(boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>(true), error);
+	}
+#endif
+}
+
+void ConnectionHandler::setCork(bool cork) {
+#ifdef TCP_CORK
+	if (local_)
+		return;
+	boost::system::error_code error;
+	socket_.set_option(boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_CORK>(cork), error);
+#else
+	(void) cork;
+#endif
+}
+
+void ConnectionHandler::enqueueWrite(std::shared_ptr<PendingWrite> write) {
+	bool wake;
+	{
+		std::lock_guard<std::mutex> lock(stagedMtx_);
+		staged_.push_back(std::move(write));
+		wake = !drainPosted_;
+		drainPosted_ = true;
+	}
+	if (wake)
+		strand_.post([this]() { drainStaged(); });
+}
+
+void ConnectionHandler::drainStaged() {
+	{
+		std::lock_guard<std::mutex> lock(stagedMtx_);
+		for (std::shared_ptr<PendingWrite> &write : staged_) {
+			queuedBytes_ += boost::asio::buffer_size(write->buffers);
+			if (write->flush)
+				flushDue_ = true;
+			writeQueue_.push_back(std::move(write));
+		}
+		staged_.clear();
+		drainPosted_ = false;
+	}
+	writeNext();
+}
+
+void ConnectionHandler::writeNext() {
+	if (writing_ || writeQueue_.empty())
+		return;
+
+	bool due = flushDue_ || flushPolicy_.mode == FlushPolicy::IMMEDIATE ||
+	           (flushPolicy_.mode == FlushPolicy::SIZE_THRESHOLD && queuedBytes_ >= flushPolicy_.sizeThreshold);
+	if (!due) {
+		// Hold the queue back, but no longer than the deadline after the first frame.
+		if (!timerArmed_ && flushPolicy_.deadlineMicros > 0) {
+			timerArmed_ = true;
+			unsigned long generation = ++timerGeneration_;
+			flushTimer_.expires_from_now(std::chrono::microseconds(flushPolicy_.deadlineMicros));
+			flushTimer_.async_wait(strand_.wrap([this, generation](const boost::system::error_code &error) {
+				// An expiry already queued when the timer was cancelled must not flush a later batch early.
+				if (error == boost::asio::error::operation_aborted || generation != timerGeneration_)
+					return;
+				timerArmed_ = false;
+				flushDue_ = true;
+				writeNext();
+			}));
+		}
+		return;
+	}
+	if (timerArmed_)
+		cancelFlushTimer();
+
+	// Everything queued so far goes out in one gathered write.
+	inFlight_.swap(writeQueue_);
+	writeBuffers_.clear();
+	for (const auto &pending : inFlight_)
+		writeBuffers_.insert(writeBuffers_.end(), pending->buffers.begin(), pending->buffers.end());
+	queuedBytes_ = 0;
+	flushDue_ = false;
+	writing_ = true;
+
+	bool cork = flushPolicy_.cork;  // the policy may change before the write completes
+	if (cork)
+		setCork(true);
+	BufferList buffers = {&writeBuffers_};
+	boost::asio::async_write(socket_, buffers, strand_.wrap(
+			[this, cork](const boost::system::error_code &error, size_t) {
+				if (cork)
+					setCork(false);
+				writing_ = false;
+				for (auto &pending : inFlight_) {
+					if (pending->done)
+						pending->done(!error);
+					recycleWrite(pending);
+				}
+				inFlight_.clear();
+				if (error) {
+					std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
+					// Nothing after a failed write can make it out either.
+					for (const auto &pending : writeQueue_) {
+						if (pending->done)
+							pending->done(false);
+					}
+					writeQueue_.clear();
+					queuedBytes_ = 0;
+					return;
+				}
+				writeNext();
+			}));
+}
+
+void ConnectionHandler::cancelFlushTimer() {
+	timerArmed_ = false;
+	timerGeneration_++;
+	flushTimer_.cancel();
+}
+
+void ConnectionHandler::run() {
+	if (transport_ == Transport::IO_URING && onFrame_) {
+		loopStopped_ = false;
+		while (!loopStopped_) {
+			std::string_view frame;
+			Slab slab;
+			bool received;
+			try {
+				received = getFrameView(frame, slab, splitter_);
+			} catch (const std::exception &e) {
+				cerr << "malformed frame, closing the connection: " << e.what() << endl;
+				boost::system::error_code ignored;
+				socket_.close(ignored);
+				received = false;
+			}
+			if (!received) {
+				if (!loopStopped_ && onClose_)
+					onClose_();
+				break;
+			}
+			if (!onFrame_(frame, slab))
+				break;
+		}
+		return;
+	}
+	io_service_.restart();
+	io_service_.run();
+}
+
+void ConnectionHandler::stop() {
+	loopStopped_ = true;
+	io_service_.stop();
+}
+
+boost::asio::io_service &ConnectionHandler::getIoService() {
+	return io_service_;
 }
 
 // Close down the connection properly.
 void ConnectionHandler::close() {
+	inStart_ = 0;
+	inEnd_ = 0;
 	try {
 		socket_.close();
 	} catch (...) {
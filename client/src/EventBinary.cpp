@@ -0,0 +1,192 @@
+#include "../include/EventBinary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include <unistd.h>
+
+// bytes before the event count in the header
+static const size_t COUNT_OFFSET = sizeof(EventBinary::MAGIC) + 4;
+
+bool EventBinary::matches(std::string_view data)
+{
+    return data.size() >= sizeof(MAGIC) && std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+static void putU32(std::string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+static void putU64(std::string &out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+static void putString(std::string &out, std::string_view value)
+{
+    if (value.size() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("string too long for an .evb file");
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+EventBinaryWriter::EventBinaryWriter(const std::string &path, const std::string &team_a_name,
+                                     const std::string &team_b_name)
+    : out(path, std::ios::binary | std::ios::trunc), path(path), buffer(), keys(), count(0)
+{
+    if (!out)
+        throw std::runtime_error("cannot create " + path);
+    buffer.append(EventBinary::MAGIC, sizeof(EventBinary::MAGIC));
+    putU32(buffer, EventBinary::VERSION);
+    putU64(buffer, 0);  // filled in by finish()
+    putString(buffer, team_a_name);
+    putString(buffer, team_b_name);
+    out.write(buffer.data(), buffer.size());
+}
+
+void EventBinaryWriter::putKey(const std::string &key)
+{
+    auto it = keys.find(key);
+    if (it != keys.end()) {
+        putU32(buffer, it->second);
+        return;
+    }
+    uint32_t id = static_cast<uint32_t>(keys.size());
+    keys.emplace(key, id);
+    putU32(buffer, id);
+    putString(buffer, key);
+}
+
+void EventBinaryWriter::putUpdates(const std::map<std::string, std::string> &updates)
+{
+    putU32(buffer, static_cast<uint32_t>(updates.size()));
+    for (const auto &update : updates) {
+        putKey(update.first);
+        putString(buffer, update.second);
+    }
+}
+
+void EventBinaryWriter::write(const Event &event)
+{
+    buffer.clear();
+    putString(buffer, event.get_name());
+    putU32(buffer, static_cast<uint32_t>(event.get_time()));
+    putUpdates(event.get_game_updates());
+    putUpdates(event.get_team_a_updates());
+    putUpdates(event.get_team_b_updates());
+    putString(buffer, event.get_description());
+    out.write(buffer.data(), buffer.size());
+    count++;
+}
+
+void EventBinaryWriter::finish()
+{
+    buffer.clear();
+    putU64(buffer, count);
+    out.seekp(COUNT_OFFSET);
+    out.write(buffer.data(), buffer.size());
+    out.close();
+    if (!out)
+        throw std::runtime_error("cannot write " + path);
+}
+
+EventBinaryReader::EventBinaryReader(std::string_view data)
+    : data(data), pos(0), remaining(0), team_a_name(), team_b_name(), keys()
+{
+    if (!EventBinary::matches(data))
+        throw std::runtime_error("not an .evb file");
+    pos = sizeof(EventBinary::MAGIC);
+    if (u32() != EventBinary::VERSION)
+        throw std::runtime_error("unsupported .evb version");
+    uint64_t low = u32();
+    uint64_t high = u32();
+    remaining = low | (high << 32);
+    team_a_name = string();
+    team_b_name = string();
+}
+
+uint32_t EventBinaryReader::u32()
+{
+    if (data.size() - pos < 4)
+        throw std::runtime_error("truncated .evb file");
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data.data() + pos);
+    pos += 4;
+    return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+           static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+std::string_view EventBinaryReader::string()
+{
+    uint32_t length = u32();
+    if (data.size() - pos < length)
+        throw std::runtime_error("truncated .evb file");
+    std::string_view value = data.substr(pos, length);
+    pos += length;
+    return value;
+}
+
+void EventBinaryReader::updates(EventsScanner::Updates &out)
+{
+    out.clear();
+    uint32_t count = u32();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t id = u32();
+        if (id == keys.size())
+            keys.push_back(string());
+        else if (id > keys.size())
+            throw std::runtime_error("corrupt .evb file: unknown key");
+        out.emplace_back(keys[id], string());
+    }
+}
+
+bool EventBinaryReader::next(EventsScanner::EventView &event)
+{
+    if (remaining == 0) {
+        if (pos != data.size())
+            throw std::runtime_error("corrupt .evb file: bytes after the last event");
+        return false;
+    }
+    event.name = string();
+    event.time = static_cast<int32_t>(u32());
+    updates(event.game_updates);
+    updates(event.team_a_updates);
+    updates(event.team_b_updates);
+    event.description = string();
+    remaining--;
+    return true;
+}
+
+uint64_t convertEventsFile(const std::string &json_path, const std::string &evb_path)
+{
+    // written to a temporary file and renamed over evb_path once complete, so a failed conversion
+    // leaves neither half a file nor the old one damaged
+    std::string temporary = evb_path + ".tmp" + std::to_string(::getpid());
+    // the names come before the first event, and are there even when the file has none
+    std::unique_ptr<EventBinaryWriter> writer;
+    try {
+        parseEventsFile(json_path,
+                        [&](const std::string &team_a_name, const std::string &team_b_name) {
+                            writer.reset(new EventBinaryWriter(temporary, team_a_name, team_b_name));
+                        },
+                        [&](Event &&event) {
+                            writer->write(event);
+                            return true;
+                        });
+        writer->finish();
+    } catch (...) {
+        writer.reset();
+        std::remove(temporary.c_str());
+        throw;
+    }
+    if (std::rename(temporary.c_str(), evb_path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("cannot create " + evb_path);
+    }
+    return writer->written();
+}
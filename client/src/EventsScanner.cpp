@@ -0,0 +1,318 @@
+#include "../include/EventsScanner.h"
+
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path) : address(nullptr), length(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("cannot open " + path);
+    struct stat info;
+    if (::fstat(fd, &info) < 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot open " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void *mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        // read once from front to back
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        address = static_cast<const char *>(mapped);
+    }
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (address != nullptr)
+        ::munmap(const_cast<char *>(address), length);
+}
+
+EventsScanner::EventView::EventView()
+    : name(), time(0), game_updates(), team_a_updates(), team_b_updates(), description() {}
+
+static std::map<std::string, std::string> toMap(const EventsScanner::Updates &updates)
+{
+    std::map<std::string, std::string> map;
+    for (const auto &update : updates)
+        map[std::string(update.first)] = std::string(update.second);  // a repeated key keeps its last value
+    return map;
+}
+
+Event EventsScanner::EventView::toEvent(const std::string &team_a_name, const std::string &team_b_name) const
+{
+    return Event(team_a_name, team_b_name, std::string(name), time, toMap(game_updates),
+                 toMap(team_a_updates), toMap(team_b_updates), std::string(description));
+}
+
+EventsScanner::EventsScanner(std::string_view json)
+    : json(json), pos(0), team_a_name(), team_b_name(), firstEvent(true) {}
+
+void EventsScanner::skipSpace()
+{
+    while (pos < json.size()) {
+        char c = json[pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            return;
+        pos++;
+    }
+}
+
+bool EventsScanner::consume(char c)
+{
+    skipSpace();
+    if (pos >= json.size() || json[pos] != c)
+        return false;
+    pos++;
+    return true;
+}
+
+// a string without escapes; out is its content
+bool EventsScanner::string(std::string_view &out)
+{
+    if (!consume('"'))
+        return false;
+    size_t start = pos;
+    while (pos < json.size()) {
+        unsigned char c = static_cast<unsigned char>(json[pos]);
+        if (c == '"') {
+            out = json.substr(start, pos - start);
+            pos++;
+            return true;
+        }
+        // an escape would need a copy to unescape into, a control character is not json
+        if (c == '\\' || c < 0x20)
+            return false;
+        pos++;
+    }
+    return false;
+}
+
+// true, false or null as written
+bool EventsScanner::literal(std::string_view &out)
+{
+    for (std::string_view word : {"true", "false", "null"}) {
+        if (json.substr(pos, word.size()) == word) {
+            out = json.substr(pos, word.size());
+            pos += word.size();
+            return true;
+        }
+    }
+    return false;
+}
+
+// An integer that dump() writes back unchanged: no leading zeros, no "-0", and small enough to
+// stay an integer. Fractions and exponents are left to the generic parser.
+bool EventsScanner::integer(std::string_view &out)
+{
+    const size_t MAX_DIGITS = 18;
+    size_t start = pos;
+    if (pos < json.size() && json[pos] == '-')
+        pos++;
+    size_t digits = pos;
+    while (pos < json.size() && json[pos] >= '0' && json[pos] <= '9')
+        pos++;
+    size_t count = pos - digits;
+    if (count == 0 || count > MAX_DIGITS || (json[digits] == '0' && (count > 1 || digits > start)))
+        return false;
+    if (pos < json.size() && (json[pos] == '.' || json[pos] == 'e' || json[pos] == 'E'))
+        return false;
+    out = json.substr(start, pos - start);
+    return true;
+}
+
+// an object of update name -> string, integer or literal
+bool EventsScanner::updates(Updates &out)
+{
+    out.clear();
+    if (!consume('{'))
+        return false;
+    if (consume('}'))
+        return true;
+    do {
+        std::string_view key;
+        std::string_view value;
+        if (!string(key) || !consume(':'))
+            return false;
+        skipSpace();
+        if (pos >= json.size())
+            return false;
+        char c = json[pos];
+        bool read = c == '"' ? string(value) : (c == '-' || (c >= '0' && c <= '9')) ? integer(value) : literal(value);
+        if (!read)
+            return false;
+        out.emplace_back(key, value);
+    } while (consume(','));
+    return consume('}');
+}
+
+bool EventsScanner::start()
+{
+    bool hasTeamA = false;
+    bool hasTeamB = false;
+    if (!consume('{'))
+        return false;
+    for (;;) {
+        std::string_view key;
+        if (!string(key) || !consume(':'))
+            return false;
+        if (key == "team a") {
+            if (!string(team_a_name))
+                return false;
+            hasTeamA = true;
+        }
+        else if (key == "team b") {
+            if (!string(team_b_name))
+                return false;
+            hasTeamB = true;
+        }
+        else if (key == "events") {
+            // the events have to come after both names, so they can be handed out as they are read
+            return hasTeamA && hasTeamB && consume('[');
+        }
+        else {
+            return false;
+        }
+        if (!consume(','))
+            return false;
+    }
+}
+
+// after an event (or before the first): EVENT if another one follows, END if the array and the
+// root object close with nothing but whitespace after them
+EventsScanner::Status EventsScanner::separator()
+{
+    bool closed;
+    if (firstEvent)
+        closed = consume(']');
+    else if (consume(','))
+        closed = false;
+    else if (consume(']'))
+        closed = true;
+    else
+        return Status::MISMATCH;
+    firstEvent = false;
+    if (!closed)
+        return Status::EVENT;
+    if (!consume('}'))
+        return Status::MISMATCH;
+    skipSpace();
+    return pos == json.size() ? Status::END : Status::MISMATCH;
+}
+
+bool EventsScanner::readEvent(EventView &event)
+{
+    if (!consume('{'))
+        return false;
+    bool hasName = false;
+    bool hasTime = false;
+    bool hasDescription = false;
+    event.game_updates.clear();
+    event.team_a_updates.clear();
+    event.team_b_updates.clear();
+    do {
+        std::string_view key;
+        if (!string(key) || !consume(':'))
+            return false;
+        bool read = false;
+        if (key == "event name") {
+            read = hasName = string(event.name);
+        }
+        else if (key == "time") {
+            std::string_view digits;
+            skipSpace();
+            long long value = 0;
+            read = hasTime = integer(digits) &&
+                             std::from_chars(digits.data(), digits.data() + digits.size(), value).ec == std::errc();
+            // what json's get<int>() does with a wider integer
+            event.time = static_cast<int>(value);
+        }
+        else if (key == "general game updates") {
+            read = updates(event.game_updates);
+        }
+        else if (key == "team a updates") {
+            read = updates(event.team_a_updates);
+        }
+        else if (key == "team b updates") {
+            read = updates(event.team_b_updates);
+        }
+        else if (key == "description") {
+            read = hasDescription = string(event.description);
+        }
+        if (!read)
+            return false;
+    } while (consume(','));
+    return consume('}') && hasName && hasTime && hasDescription;
+}
+
+// Moves past the object at pos, only following strings and brackets. Strings are jumped over with
+// memchr, which is exact because the scanner never accepts escapes.
+bool EventsScanner::skipObject(std::string_view &object)
+{
+    skipSpace();
+    if (pos >= json.size() || json[pos] != '{')
+        return false;
+    size_t start = pos;
+    size_t depth = 0;
+    while (pos < json.size()) {
+        char c = json[pos];
+        if (c == '"') {
+            const char *from = json.data() + pos + 1;
+            const void *quote = std::memchr(from, '"', json.size() - pos - 1);
+            if (quote == nullptr || std::memchr(from, '\\', static_cast<const char *>(quote) - from) != nullptr)
+                return false;
+            pos = static_cast<const char *>(quote) - json.data() + 1;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        }
+        else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                pos++;
+                object = json.substr(start, pos - start);
+                return true;
+            }
+        }
+        pos++;
+    }
+    return false;
+}
+
+EventsScanner::Status EventsScanner::next(EventView &event)
+{
+    Status status = separator();
+    if (status != Status::EVENT)
+        return status;
+    return readEvent(event) ? Status::EVENT : Status::MISMATCH;
+}
+
+EventsScanner::Status EventsScanner::nextObject(std::string_view &object)
+{
+    Status status = separator();
+    if (status != Status::EVENT)
+        return status;
+    return skipObject(object) ? Status::EVENT : Status::MISMATCH;
+}
+
+bool EventsScanner::parseEvent(std::string_view object, EventView &event)
+{
+    EventsScanner scanner(object);
+    if (!scanner.readEvent(event))
+        return false;
+    scanner.skipSpace();
+    return scanner.pos == object.size();
+}
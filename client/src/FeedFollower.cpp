@@ -0,0 +1,137 @@
+#include "../include/FeedFollower.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FeedFollower::FeedFollower(const std::string &path)
+    : path(path), fd(-1), inotifyFd(-1), offset(0), pending(), before()
+{
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("cannot open " + path);
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // IN_ATTRIB because unlinking changes the link count; IN_DELETE_SELF waits for our descriptor to close
+    if (inotifyFd < 0 ||
+        ::inotify_add_watch(inotifyFd, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF) < 0) {
+        if (inotifyFd >= 0)
+            ::close(inotifyFd);
+        ::close(fd);
+        throw std::runtime_error("cannot watch " + path);
+    }
+}
+
+FeedFollower::~FeedFollower()
+{
+    ::close(inotifyFd);
+    ::close(fd);
+}
+
+std::string FeedFollower::bytesBeforeOffset() const
+{
+    size_t length = static_cast<size_t>(std::min<off_t>(offset, FINGERPRINT_BYTES));
+    std::string bytes(length, '\0');
+    ssize_t n = ::pread(fd, &bytes[0], length, offset - static_cast<off_t>(length));
+    bytes.resize(n < 0 ? 0 : static_cast<size_t>(n));
+    return bytes;
+}
+
+bool FeedFollower::readLines(const std::function<bool(std::string_view)> &onLine)
+{
+    // truncated, and maybe written again past offset since: whatever is there now was written after it
+    struct stat info;
+    if ((::fstat(fd, &info) == 0 && info.st_size < offset) || bytesBeforeOffset() != before) {
+        offset = 0;
+        pending.clear();
+    }
+
+    bool more = readAvailable(onLine);
+    before = bytesBeforeOffset();
+    return more;
+}
+
+bool FeedFollower::readAvailable(const std::function<bool(std::string_view)> &onLine)
+{
+    char buffer[65536];
+    for (;;) {
+        ssize_t n = ::pread(fd, buffer, sizeof(buffer), offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return true;
+
+        // offset only moves past what is handed out (or kept in pending), so lines after one
+        // onLine stopped at are read again next time
+        std::string_view chunk(buffer, static_cast<size_t>(n));
+        size_t newline;
+        while ((newline = chunk.find('\n')) != std::string_view::npos) {
+            std::string_view line = chunk.substr(0, newline);
+            chunk.remove_prefix(newline + 1);
+            offset += newline + 1;
+            bool more;
+            if (pending.empty()) {
+                more = onLine(line);
+            }
+            else {
+                pending.append(line);
+                more = onLine(pending);
+                pending.clear();
+            }
+            if (!more)
+                return false;
+        }
+        pending.append(chunk);
+        offset += chunk.size();
+    }
+}
+
+FeedFollower::Wake FeedFollower::wait(int stopFd)
+{
+    for (;;) {
+        struct pollfd fds[2];
+        fds[0].fd = inotifyFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = stopFd;
+        fds[1].events = POLLIN;
+        if (::poll(fds, stopFd < 0 ? 1 : 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("cannot wait for " + path);
+        }
+
+        // the events come in batches; only what kind of change happened matters
+        bool written = false;
+        bool gone = false;
+        alignas(struct inotify_event) char events[4096];
+        ssize_t n;
+        while ((n = ::read(inotifyFd, events, sizeof(events))) > 0) {
+            for (char *at = events; at < events + n;) {
+                const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(at);
+                if (event->mask & IN_MODIFY)
+                    written = true;
+                if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+                    gone = true;
+                at += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        // deleted, or something else renamed over the path (which is not always reported)
+        struct stat info, named;
+        if (::fstat(fd, &info) == 0 &&
+            (info.st_nlink == 0 || ::stat(path.c_str(), &named) != 0 || named.st_ino != info.st_ino ||
+             named.st_dev != info.st_dev))
+            gone = true;
+
+        if (gone)
+            return Wake::GONE;
+        if (written)
+            return Wake::DATA;
+        if (stopFd >= 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR)))
+            return Wake::STOPPED;
+    }
+}
@@ -0,0 +1,231 @@
+#include "../include/IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+static int ioUringSetup(unsigned entries, io_uring_params *params) {
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void *arg, unsigned count) {
+	return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+IoUring::IoUring(unsigned entries) : ringFd_(-1), sqRing_(MAP_FAILED), sqRingSize_(0), cqRing_(MAP_FAILED),
+                                     cqRingSize_(0), sqes_(nullptr), sqesSize_(0), sqHead_(nullptr),
+                                     sqTail_(nullptr), sqMask_(nullptr), sqArray_(nullptr), cqHead_(nullptr),
+                                     cqTail_(nullptr), cqMask_(nullptr), cqes_(nullptr),
+                                     buffersRegistered_(false), supportedOps_() {
+	io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	ringFd_ = ioUringSetup(entries, &params);
+	if (ringFd_ < 0)
+		return;
+
+	sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMmap) {
+		if (cqRingSize_ > sqRingSize_)
+			sqRingSize_ = cqRingSize_;
+		cqRingSize_ = sqRingSize_;
+	}
+
+	sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+	               IORING_OFF_SQ_RING);
+	if (sqRing_ == MAP_FAILED) {
+		close(ringFd_);
+		ringFd_ = -1;
+		return;
+	}
+	if (singleMmap) {
+		cqRing_ = sqRing_;
+	} else {
+		cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+		               IORING_OFF_CQ_RING);
+		if (cqRing_ == MAP_FAILED) {
+			munmap(sqRing_, sqRingSize_);
+			sqRing_ = MAP_FAILED;
+			close(ringFd_);
+			ringFd_ = -1;
+			return;
+		}
+	}
+
+	sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+	void *sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_,
+	                  IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		if (cqRing_ != sqRing_)
+			munmap(cqRing_, cqRingSize_);
+		munmap(sqRing_, sqRingSize_);
+		sqRing_ = cqRing_ = MAP_FAILED;
+		close(ringFd_);
+		ringFd_ = -1;
+		return;
+	}
+	sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+	char *sq = static_cast<char *>(sqRing_);
+	sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+	sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+	sqMask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+	sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+	char *cq = static_cast<char *>(cqRing_);
+	cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+	cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+	cqMask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+	cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+	probe();
+}
+
+void IoUring::probe() {
+	// io_uring_probe is followed by one io_uring_probe_op per opcode
+	const unsigned maxOps = static_cast<unsigned>(supportedOps_.size());
+	std::vector<char> buffer(sizeof(io_uring_probe) + maxOps * sizeof(io_uring_probe_op), 0);
+	io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+	if (ioUringRegister(ringFd_, IORING_REGISTER_PROBE, probe, maxOps) < 0)
+		return;
+	for (unsigned i = 0; i < probe->ops_len; i++) {
+		if (probe->ops[i].flags & IO_URING_OP_SUPPORTED)
+			supportedOps_.set(probe->ops[i].op);
+	}
+}
+
+IoUring::~IoUring() {
+	if (ringFd_ < 0)
+		return;
+	if (buffersRegistered_)
+		ioUringRegister(ringFd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+	munmap(sqes_, sqesSize_);
+	if (cqRing_ != sqRing_)
+		munmap(cqRing_, cqRingSize_);
+	munmap(sqRing_, sqRingSize_);
+	close(ringFd_);
+}
+
+bool IoUring::isAvailable() const {
+	return ringFd_ >= 0;
+}
+
+bool IoUring::supports(unsigned char opcode) const {
+	return supportedOps_.test(opcode);
+}
+
+bool IoUring::registerBuffers(const struct iovec *buffers, unsigned count) {
+	if (ringFd_ < 0)
+		return false;
+	buffersRegistered_ = ioUringRegister(ringFd_, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+	return buffersRegistered_;
+}
+
+io_uring_sqe *IoUring::nextSqe() {
+	unsigned tail = *sqTail_;
+	unsigned index = tail & *sqMask_;
+	io_uring_sqe *sqe = &sqes_[index];
+	std::memset(sqe, 0, sizeof(*sqe));
+	sqArray_[index] = index;
+	*sqTail_ = tail + 1; // published to the kernel by the release store in submitAndWait
+	return sqe;
+}
+
+bool IoUring::submitAndWait(unsigned count, int results[]) {
+	__atomic_store_n(sqTail_, *sqTail_, __ATOMIC_RELEASE);
+
+	unsigned flags = IORING_ENTER_GETEVENTS;
+	unsigned toSubmit = count;
+
+	unsigned reaped = 0;
+	while (reaped < count) {
+		unsigned head = *cqHead_;
+		unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			int ret = ioUringEnter(ringFd_, toSubmit, count - reaped, flags);
+			if (ret < 0 && errno != EINTR)
+				return false;
+			if (ret > 0)
+				toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(ret));
+			continue;
+		}
+		// entries complete in submission order here: each call waits for all of them before returning
+		io_uring_cqe *cqe = &cqes_[head & *cqMask_];
+		results[cqe->user_data] = cqe->res;
+		__atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+		reaped++;
+	}
+	return true;
+}
+
+int IoUring::read(int fd, char *buf, size_t len, int bufferIndex) {
+	io_uring_sqe *sqe = nextSqe();
+	if (bufferIndex >= 0 && buffersRegistered_) {
+		sqe->opcode = IORING_OP_READ_FIXED;
+		sqe->buf_index = static_cast<unsigned short>(bufferIndex);
+	} else {
+		sqe->opcode = IORING_OP_READ;
+	}
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<unsigned long>(buf);
+	sqe->len = static_cast<unsigned>(len);
+	sqe->user_data = 0;
+
+	int result = 0;
+	if (!submitAndWait(1, &result))
+		return -errno;
+	return result;
+}
+
+long IoUring::writev(int fd, const struct iovec *iov, unsigned count) {
+	// One linked WRITEV per IOV_MAX buffers, all submitted with a single io_uring_enter.
+	unsigned batches = (count + IOV_MAX - 1) / IOV_MAX;
+	unsigned ringEntries = *sqMask_ + 1;
+	if (batches > ringEntries)
+		batches = ringEntries;
+
+	std::vector<int> results(batches, 0);
+	std::vector<size_t> expected(batches, 0);
+	for (unsigned i = 0; i < batches; i++) {
+		unsigned first = i * IOV_MAX;
+		unsigned n = std::min<unsigned>(IOV_MAX, count - first);
+		for (unsigned j = first; j < first + n; j++)
+			expected[i] += iov[j].iov_len;
+
+		io_uring_sqe *sqe = nextSqe();
+		sqe->opcode = IORING_OP_WRITEV;
+		sqe->fd = fd;
+		sqe->addr = reinterpret_cast<unsigned long>(iov + first);
+		sqe->len = n;
+		sqe->user_data = i;
+		if (i + 1 < batches)
+			sqe->flags |= IOSQE_IO_LINK;
+	}
+	if (!submitAndWait(batches, results.data()))
+		return -errno;
+
+	// A short write breaks the link; report what went out in order so the caller can resume.
+	long written = 0;
+	for (unsigned i = 0; i < batches; i++) {
+		if (results[i] < 0)
+			return written > 0 ? written : results[i];
+		written += results[i];
+		if (static_cast<size_t>(results[i]) < expected[i])
+			break;
+	}
+	return written;
+}
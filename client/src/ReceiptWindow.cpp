@@ -0,0 +1,132 @@
+#include "../include/ReceiptWindow.h"
+#include <algorithm>
+#include <charconv>
+
+ReceiptWindow::ReceiptWindow(size_t limit)
+    : outstanding(), limit(std::max(MIN_LIMIT, limit)), closed(false), mtx(), cv(),
+      adaptive(false), slowStart(true), baseRtt(Clock::duration::zero()), roundMinRtt(Clock::duration::zero()),
+      roundAcks(0), roundFilled(false) {}
+
+void ReceiptWindow::setLimit(size_t newLimit) {
+    std::lock_guard<std::mutex> lock(mtx);
+    adaptive = false;
+    limit = std::min(MAX_LIMIT, std::max(MIN_LIMIT, newLimit));
+    cv.notify_all();
+}
+
+void ReceiptWindow::setAdaptive() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!adaptive && baseRtt == Clock::duration::zero()) {
+        // nothing learned yet on this connection
+        limit = INITIAL_ADAPTIVE_LIMIT;
+        slowStart = true;
+    }
+    adaptive = true;
+    roundAcks = 0;
+    roundMinRtt = Clock::duration::zero();
+    roundFilled = false;
+    cv.notify_all();
+}
+
+size_t ReceiptWindow::getLimit() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return limit;
+}
+
+ReceiptWindow::Clock::duration ReceiptWindow::getBaseRtt() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return baseRtt;
+}
+
+bool ReceiptWindow::acquire(long receiptId) {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return closed || outstanding.size() < limit; });
+    if (closed)
+        return false;
+    outstanding[receiptId] = Clock::now();
+    if (outstanding.size() >= limit)
+        roundFilled = true;
+    return true;
+}
+
+bool ReceiptWindow::retire(std::string_view receiptId) {
+    long id = 0;
+    auto parsed = std::from_chars(receiptId.data(), receiptId.data() + receiptId.size(), id);
+    if (parsed.ec != std::errc() || parsed.ptr != receiptId.data() + receiptId.size())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = outstanding.find(id);
+    if (it == outstanding.end())
+        return false;
+    Clock::duration rtt = Clock::now() - it->second;
+    outstanding.erase(it);
+    onRtt(rtt);
+    cv.notify_all();
+    return true;
+}
+
+// called with mtx held for every retired receipt
+void ReceiptWindow::onRtt(Clock::duration rtt) {
+    if (baseRtt == Clock::duration::zero() || rtt < baseRtt)
+        baseRtt = rtt;
+    if (roundMinRtt == Clock::duration::zero() || rtt < roundMinRtt)
+        roundMinRtt = rtt;
+    if (!adaptive || ++roundAcks < limit)
+        return;
+
+    // End of a round: the least delayed receipt of the round filters out scheduling noise
+    double queued = limit * (1.0 - std::chrono::duration<double>(baseRtt).count() /
+                                   std::chrono::duration<double>(roundMinRtt).count());
+    if (queued >= std::max(limit / 2.0, 2 * QUEUE_HIGH)) {
+        slowStart = false;
+        limit = std::max(MIN_LIMIT, limit / 2);
+    }
+    else if (slowStart) {
+        if (queued > 1) {
+            // queueing showed up: leave slow start a little below where it began
+            slowStart = false;
+            limit = std::max(MIN_LIMIT, limit - limit / 8);
+        }
+        else if (roundFilled) {
+            limit = std::min(MAX_LIMIT, limit * 2);
+        }
+    }
+    else if (queued < QUEUE_LOW) {
+        if (roundFilled)
+            limit = std::min(MAX_LIMIT, limit + 1);
+    }
+    else if (queued > QUEUE_HIGH) {
+        limit = std::max(MIN_LIMIT, limit - 1);
+    }
+
+    roundAcks = 0;
+    roundMinRtt = Clock::duration::zero();
+    roundFilled = outstanding.size() >= limit;
+}
+
+bool ReceiptWindow::drain() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return closed || outstanding.empty(); });
+    return !closed;
+}
+
+void ReceiptWindow::close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    outstanding.clear();
+    cv.notify_all();
+}
+
+void ReceiptWindow::reset() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = false;
+    outstanding.clear();
+    slowStart = true;
+    baseRtt = Clock::duration::zero();
+    roundMinRtt = Clock::duration::zero();
+    roundAcks = 0;
+    roundFilled = false;
+    if (adaptive)
+        limit = INITIAL_ADAPTIVE_LIMIT;
+}
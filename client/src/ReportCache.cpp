@@ -0,0 +1,205 @@
+#include "../include/ReportCache.h"
+
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <tuple>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// first record of a cache file; bump the version when the layout changes
+static const char CACHE_FILE_MAGIC[] = "stomp-report-cache 1";
+
+bool ReportCache::Key::operator<(const Key& other) const {
+    return std::tie(path, size, mtime, user) < std::tie(other.path, other.size, other.mtime, other.user);
+}
+
+bool ReportCache::Key::operator==(const Key& other) const {
+    return std::tie(path, size, mtime, user) == std::tie(other.path, other.size, other.mtime, other.user);
+}
+
+size_t ReportCache::Entry::bytes() const {
+    size_t total = sizeof(Entry) + teamA.size() + teamB.size();
+    for (const std::string& body : bodies)
+        total += sizeof(std::string) + body.size();
+    return total;
+}
+
+ReportCache::ReportCache(size_t budget) : slots(), budget(budget), used(0), uses(0), directory() {}
+
+bool ReportCache::setDirectory(const std::string& dir) {
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error || !std::filesystem::is_directory(dir, error)) {
+        std::cerr << "cannot use " << dir << " for the report cache: " << error.message() << "\n";
+        return false;
+    }
+    directory = dir;
+    return true;
+}
+
+bool ReportCache::keyFor(const std::string& path, const std::string& user, Key& key) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) < 0)
+        return false;
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    key.path = error ? path : absolute.lexically_normal().string();
+    key.size = static_cast<uint64_t>(info.st_size);
+    key.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    key.user = user;
+    return true;
+}
+
+std::shared_ptr<const ReportCache::Entry> ReportCache::find(const Key& key) {
+    auto it = slots.find(key);
+    if (it != slots.end()) {
+        it->second.lastUse = ++uses;
+        return it->second.entry;
+    }
+    if (directory.empty())
+        return nullptr;
+    std::shared_ptr<const Entry> entry = load(key);
+    if (entry)
+        keep(key, entry, entry->bytes());
+    return entry;
+}
+
+void ReportCache::store(const Key& key, std::shared_ptr<const Entry> entry) {
+    if (!directory.empty() && !save(key, *entry))
+        std::cerr << "could not write the report cache for " << key.path << "\n";
+    keep(key, entry, entry->bytes());
+}
+
+// adds entry to memory, dropping the least recently used entries until it fits
+void ReportCache::keep(const Key& key, std::shared_ptr<const Entry> entry, size_t bytes) {
+    auto old = slots.find(key);
+    if (old != slots.end()) {
+        used -= old->second.bytes;
+        slots.erase(old);
+    }
+    if (bytes > budget)
+        return;
+    while (used + bytes > budget) {
+        auto oldest = slots.begin();
+        for (auto it = slots.begin(); it != slots.end(); ++it)
+            if (it->second.lastUse < oldest->second.lastUse)
+                oldest = it;
+        used -= oldest->second.bytes;
+        slots.erase(oldest);
+    }
+    slots.emplace(key, Slot(entry, bytes, ++uses));
+    used += bytes;
+}
+
+// One file per path and user; a newer version of the file replaces the older one's entry.
+// The key inside tells whether it is still current.
+std::string ReportCache::fileFor(const Key& key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016zx.rcache", std::hash<std::string>()(key.path + '\n' + key.user));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+// The file is a sequence of records "<length>\n<bytes>", the way batch SENDs carry events:
+// magic, path, size, mtime, user, team a, team b, body count, then the bodies.
+static void appendRecord(std::string& out, std::string_view record) {
+    out += std::to_string(record.size());
+    out += '\n';
+    out += record;
+}
+
+static bool nextRecord(std::string_view& in, std::string_view& record) {
+    size_t length = 0;
+    auto parsed = std::from_chars(in.data(), in.data() + in.size(), length);
+    if (parsed.ec != std::errc() || parsed.ptr == in.data() + in.size() || *parsed.ptr != '\n')
+        return false;
+    in.remove_prefix(parsed.ptr + 1 - in.data());
+    if (length > in.size())
+        return false;
+    record = in.substr(0, length);
+    in.remove_prefix(length);
+    return true;
+}
+
+template <typename T>
+static bool nextNumber(std::string_view& in, T& value) {
+    std::string_view record;
+    if (!nextRecord(in, record))
+        return false;
+    auto parsed = std::from_chars(record.data(), record.data() + record.size(), value);
+    return parsed.ec == std::errc() && parsed.ptr == record.data() + record.size();
+}
+
+std::shared_ptr<const ReportCache::Entry> ReportCache::load(const Key& key) const {
+    std::ifstream file(fileFor(key), std::ios::binary);
+    if (!file)
+        return nullptr;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string data = contents.str();
+    std::string_view in(data);
+
+    std::string_view magic, path, user, teamA, teamB;
+    Key stored;
+    size_t count = 0;
+    if (!nextRecord(in, magic) || magic != CACHE_FILE_MAGIC || !nextRecord(in, path) ||
+        !nextNumber(in, stored.size) || !nextNumber(in, stored.mtime) || !nextRecord(in, user) ||
+        !nextRecord(in, teamA) || !nextRecord(in, teamB) || !nextNumber(in, count))
+        return nullptr;
+    stored.path = std::string(path);
+    stored.user = std::string(user);
+    if (!(stored == key))
+        return nullptr;
+
+    auto entry = std::make_shared<Entry>();
+    entry->teamA = std::string(teamA);
+    entry->teamB = std::string(teamB);
+    entry->bodies.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string_view body;
+        if (!nextRecord(in, body))
+            return nullptr;
+        entry->bodies.emplace_back(body);
+    }
+    if (!in.empty())
+        return nullptr;
+    return entry;
+}
+
+// written to a temporary file and renamed over the old one, so a reader never sees half of it
+bool ReportCache::save(const Key& key, const Entry& entry) const {
+    std::string data;
+    appendRecord(data, CACHE_FILE_MAGIC);
+    appendRecord(data, key.path);
+    appendRecord(data, std::to_string(key.size));
+    appendRecord(data, std::to_string(key.mtime));
+    appendRecord(data, key.user);
+    appendRecord(data, entry.teamA);
+    appendRecord(data, entry.teamB);
+    appendRecord(data, std::to_string(entry.bodies.size()));
+    for (const std::string& body : entry.bodies)
+        appendRecord(data, body);
+
+    std::string target = fileFor(key);
+    std::string temporary = target + ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        file.close();
+        if (!file) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), target.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
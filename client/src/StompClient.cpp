@@ -1,18 +1,35 @@
 #include "../include/ConnectionHandler.h"
 #include "../include/StompFrame.h"
+#include "../include/StompFrameView.h"
+#include "../include/StompParser.h"
+#include "../include/StompProtocol.h"
 #include "../include/event.h"
 #include "../include/GameDB.h"
+#include "../include/ReceiptWindow.h"
+#include "../include/BoundedQueue.h"
+#include "../include/ReportCache.h"
+#include "../include/FeedFollower.h"
+#include "../include/TimerWheel.h"
 
 #include <mutex>
 #include <condition_variable>
 #include <iostream>
 #include <sstream>
 #include <thread>
+#include <future>
+#include <exception>
+#include <memory>
 #include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <cctype>
+#include <algorithm>
 #include <fstream>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <unistd.h>
 
 std::atomic<bool> disconnecting(false);
 
@@ -26,34 +43,169 @@ static std::string trim(std::string s) {
 }
 
 // gets the game from the destination (converts "/topic/gameName" to "gameName")
-static std::string getGameFromDestination(const std::string& dest) {
-    std::string prefix = "/topic/";
+static std::string getGameFromDestination(std::string_view dest) {
+    std::string_view prefix = "/topic/";
     if (dest.size() >= prefix.size() && dest.substr(0, prefix.size()) == prefix) {
-        return dest.substr(prefix.size());
+        return std::string(dest.substr(prefix.size()));
     }
-    return dest;
+    return std::string(dest);
 }
 
+// frames are serialized into this buffer, which is reused so sending does not allocate once it has grown
+static std::string sendBuffer;
+
+// sends the frame exactly as toString() + '\0' would
 static bool sendFrame(ConnectionHandler& handler, const StompFrame& frame) {
-    std::string s = frame.toString();
-    if (!s.empty() && s.back() == '\0') {
-        s.pop_back();
+    sendBuffer.clear();
+    frame.appendTo(sendBuffer);
+    return handler.sendBytes(sendBuffer.data(), static_cast<int>(sendBuffer.size()));
+}
+
+// parses the connection options of the login command:
+// --sndbuf=BYTES --rcvbuf=BYTES --nodelay=0|1 --quickack=0|1 --busy-poll=USEC --keepalive=IDLE,INTERVAL,COUNT
+// --transport=boost|uring --flush=immediate|deadline,USEC|size,BYTES,USEC --cork=0|1
+static bool parseSocketOptions(const std::string& args,
+                               ConnectionHandler::SocketOptions& options,
+                               ConnectionHandler::Transport& transport,
+                               ConnectionHandler::FlushPolicy& flushPolicy) {
+    std::istringstream iss(args);
+    std::string option;
+
+    while (iss >> option) {
+        size_t eq = option.find('=');
+        std::string name = option.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+        try {
+            if (name == "--sndbuf") 
+                options.sendBufferSize = std::stoi(value);
+            else if (name == "--rcvbuf") 
+                options.receiveBufferSize = std::stoi(value);
+            else if (name == "--nodelay") 
+                options.noDelay = std::stoi(value) != 0;
+            else if (name == "--quickack") 
+                options.quickAck = std::stoi(value) != 0;
+            else if (name == "--busy-poll") 
+                options.busyPollMicros = std::stoi(value);
+            else if (name == "--keepalive") {
+                // idle,interval,count in seconds
+                std::istringstream timings(value);
+                std::string idle, interval, count;
+                std::getline(timings, idle, ',');
+                std::getline(timings, interval, ',');
+                std::getline(timings, count);
+                options.keepAlive = true;
+                options.keepAliveIdle = std::stoi(idle);
+                options.keepAliveInterval = interval.empty() ? 0 : std::stoi(interval);
+                options.keepAliveCount = count.empty() ? 0 : std::stoi(count);
+            }
+            else if (name == "--transport" && (value == "boost" || value == "uring")) 
+                transport = value == "uring" ? ConnectionHandler::Transport::IO_URING
+                                             : ConnectionHandler::Transport::BOOST;
+            else if (name == "--flush") {
+                // how queued frames are coalesced: at once, after a deadline, or once BYTES are queued
+                // (at most USEC later, so a short tail still goes out)
+                std::istringstream fields(value);
+                std::string mode, first, second;
+                std::getline(fields, mode, ',');
+                std::getline(fields, first, ',');
+                std::getline(fields, second);
+                if (mode == "immediate" && first.empty())
+                    flushPolicy.mode = ConnectionHandler::FlushPolicy::IMMEDIATE;
+                else if (mode == "deadline" && std::stol(first) > 0 && second.empty()) {
+                    flushPolicy.mode = ConnectionHandler::FlushPolicy::DEADLINE;
+                    flushPolicy.deadlineMicros = std::stol(first);
+                }
+                else if (mode == "size" && std::stoul(first) > 0 && std::stol(second) > 0) {
+                    flushPolicy.mode = ConnectionHandler::FlushPolicy::SIZE_THRESHOLD;
+                    flushPolicy.sizeThreshold = std::stoul(first);
+                    flushPolicy.deadlineMicros = std::stol(second);
+                }
+                else
+                    throw std::invalid_argument(value);
+            }
+            else if (name == "--cork") 
+                flushPolicy.cork = std::stoi(value) != 0;
+            else {
+                std::cerr << "unknown socket option: " << option << "\n";
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "bad socket option: " << option << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// events the report parser thread may read ahead of the sender
+static const size_t REPORT_QUEUE_CAPACITY = 256;
+
+// frames a transaction may leave in the outbound queue before a blocking send writes them out,
+// so a whole-file transaction does not hold the whole file in memory
+static const size_t TRANSACTION_QUEUE_FRAMES = 256;
+
+// how report publishes the events of a file
+struct ReportOptions {
+    size_t window;           // SENDs that may wait for their RECEIPT at the same time, 0 to size it from measured RTTs
+    size_t batchSize;        // events carried by each SEND, as length-prefixed records when more than one
+    bool transactional;      // send in BEGIN/COMMIT transactions, one receipt per COMMIT
+    size_t transactionSize;  // SENDs per transaction, 0 for the whole file
+
+    ReportOptions() : window(0), batchSize(1), transactional(false), transactionSize(0) {}
+};
+
+// parses the options of the report command: --window=N|auto --batch=EVENTS --transaction[=SENDS]
+static bool parseReportOptions(const std::string& args, ReportOptions& options) {
+    std::istringstream iss(args);
+    std::string option;
+
+    while (iss >> option) {
+        size_t eq = option.find('=');
+        std::string name = option.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+        try {
+            if (name == "--window" && value == "auto")
+                options.window = 0;
+            else if (name == "--window" && std::stoi(value) > 0)
+                options.window = std::stoi(value);
+            else if (name == "--batch" && std::stoi(value) > 0)
+                options.batchSize = std::stoi(value);
+            else if (name == "--transaction") {
+                options.transactional = true;
+                options.transactionSize = value.empty() ? 0 : std::stoul(value);
+            }
+            else {
+                std::cerr << "unknown report option: " << option << "\n";
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "bad report option: " << option << "\n";
+            return false;
+        }
     }
-    return handler.sendFrameAscii(s, '\0');
+    return true;
+}
+
+// queues the frame behind earlier writes and returns without waiting for it to be written,
+// so frames sent back to back are coalesced into one write (the next sendFrame flushes them).
+// It is serialized straight into one of the handler's recycled send buffers
+static void queueFrame(ConnectionHandler& handler, const StompFrame& frame) {
+    handler.asyncSendSerialized([&frame](std::string& out) { frame.appendTo(out); });
 }
 
 // extract user from MESSAGE body
-static std::string getUserFromBody(const std::string& body, const std::string& activeUser) {
-    std::istringstream iss(body);
-    std::string line;
+static std::string getUserFromBody(std::string_view body, const std::string& activeUser) {
+    while (!body.empty()) {
+        size_t lineEnd = body.find('\n');
+        std::string_view line = body.substr(0, lineEnd);
+        body.remove_prefix(lineEnd == std::string_view::npos ? body.size() : lineEnd + 1);
 
-    while (std::getline(iss, line)) {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
 
         if (line.size() >= 5 && line.substr(0,5) == "user:") {
-            std::string u = line.substr(5);
-            if (!u.empty() && u[0] == ' ') u.erase(0,1);
-            return u;
+            std::string_view u = line.substr(5);
+            if (!u.empty() && u[0] == ' ') u.remove_prefix(1);
+            return std::string(u);
         }
     }
     return activeUser;
@@ -90,6 +242,224 @@ static std::string buildEventBody(const Event& ev, const std::string& user) {
     return out.str();
 }
 
+// A batch SEND carries batch-count event bodies, each as a record "<length>\n<body>"
+static void appendBatchRecord(std::string& batch, const std::string& record) {
+    batch += std::to_string(record.size());
+    batch += '\n';
+    batch += record;
+}
+
+// splits a batch body into its records; false if it holds fewer than count well-formed records
+template <typename F>
+static bool forEachBatchRecord(std::string_view batch, size_t count, F onRecord) {
+    for (size_t i = 0; i < count; i++) {
+        size_t length = 0;
+        auto parsed = std::from_chars(batch.data(), batch.data() + batch.size(), length);
+        if (parsed.ec != std::errc() || parsed.ptr == batch.data() + batch.size() || *parsed.ptr != '\n')
+            return false;
+        batch.remove_prefix(parsed.ptr + 1 - batch.data());
+        if (length > batch.size())
+            return false;
+        onRecord(batch.substr(0, length));
+        batch.remove_prefix(length);
+    }
+    return true;
+}
+
+// report --follow: publishes each event line appended to an NDJSON feed as soon as its '\n' is written,
+// starting with the lines already there. Stops when the feed is deleted or moved away, or when a
+// line is typed on stdin (that line is then read as the next command).
+static void followFeed(ConnectionHandler& handler,
+                       const std::string& path,
+                       const ReportOptions& options,
+                       const std::string& activeUser,
+                       const std::unordered_map<std::string, std::string>& gameToSubId,
+                       ReceiptWindow& receiptWindow,
+                       int& nextReceiptId)
+{
+    std::unique_ptr<FeedFollower> feed;
+    try {
+        feed.reset(new FeedFollower(path));
+    } catch (const std::exception& e) {
+        std::cerr << "could not follow " << path << ": " << e.what() << "\n";
+        return;
+    }
+
+    if (options.window == 0)
+        receiptWindow.setAdaptive();
+    else
+        receiptWindow.setLimit(options.window);
+
+    // one SEND per line, written out right away rather than waiting to fill a batch or transaction
+    std::string teamA, teamB;
+    size_t sent = 0;
+    bool acknowledged = true;
+    auto onLine = [&](std::string_view line) {
+        if (trim(std::string(line)).empty())
+            return true;
+        Event ev{std::string_view()};  // empty until parsed into
+        try {
+            if (!parseEventLine(line, teamA, teamB, ev))
+                return true;
+        } catch (const std::exception& e) {
+            std::cerr << "skipping a bad line in " << path << ": " << e.what() << "\n";
+            return true;
+        }
+
+        std::string gameName = teamA + "_" + teamB;
+        if (gameToSubId.find(gameName) == gameToSubId.end()) {
+            std::cerr << "You must join " << gameName << " before reporting.\n";
+            return true;
+        }
+
+        int thisReceiptId = nextReceiptId++;
+        if (!receiptWindow.acquire(thisReceiptId)) {
+            acknowledged = false;
+            return false;
+        }
+        StompFrame send(FrameType::SEND, buildEventBody(ev, activeUser),
+                        {{"destination", "/topic/" + gameName},
+                         {"filename", path},
+                         {"receipt", std::to_string(thisReceiptId)}});
+        sendFrame(handler, send);
+        sent++;
+        return true;
+    };
+
+    // a line on stdin stops following. poll only sees what std::cin has not read ahead yet, so its
+    // buffer is checked first; once stdin is at its end (input piped in, or ^D) nothing can stop it
+    // any more, and it follows until the feed goes away
+    std::cout << "Following " << path << ", press enter to stop\n";
+    try {
+        bool watchStdin = std::cin.good();
+        while (feed->readLines(onLine)) {
+            if (watchStdin && std::cin.rdbuf()->in_avail() > 0)
+                break;
+            FeedFollower::Wake wake = feed->wait(watchStdin ? STDIN_FILENO : -1);
+            if (wake == FeedFollower::Wake::STOPPED) {
+                if (std::cin.peek() != std::char_traits<char>::eof())
+                    break;
+                watchStdin = false;
+            }
+            else if (wake == FeedFollower::Wake::GONE) {
+                // lines written just before the feed went away
+                if (acknowledged)
+                    feed->readLines(onLine);
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "stopped following " << path << ": " << e.what() << "\n";
+    }
+
+    if (!acknowledged || !receiptWindow.drain()) {
+        std::cerr << "connection lost before all reports were acknowledged\n";
+        return;
+    }
+    std::cout << "Sent " << sent << " reports from " << path << "\n";
+}
+
+// replay's timer resolution: an event is published on the first tick at or after its time
+static const std::chrono::microseconds REPLAY_TICK(1000);
+
+// replay {file} {speed}: publishes each event of the file (json or .evb) at its time, counted from the
+// first event's, divided by speed. The bodies are built up front; a scheduler thread keeps one timer
+// per event in a TimerWheel and sleeps until the next one is due, so events due together go out in
+// one write. How late each SEND left compared to its exact time is reported at the end.
+static void replayFile(ConnectionHandler& handler,
+                       const std::string& path,
+                       double speed,
+                       const std::string& activeUser,
+                       const std::unordered_map<std::string, std::string>& gameToSubId,
+                       ReceiptWindow& receiptWindow,
+                       int& nextReceiptId)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    names_and_events parsed;
+    try {
+        parsed = parseEventsFile(path, 0);
+    } catch (const std::exception& e) {
+        std::cerr << "could not read " << path << ": " << e.what() << "\n";
+        return;
+    }
+
+    std::string gameName = parsed.team_a_name + "_" + parsed.team_b_name;
+    if (gameToSubId.find(gameName) == gameToSubId.end()) {
+        std::cerr << "You must join " << gameName << " before reporting.\n";
+        return;
+    }
+    std::string dest = "/topic/" + gameName;
+
+    // when each event is due after the start; events earlier than the first one are due at once
+    std::vector<std::string> bodies;
+    std::vector<Clock::duration> due;
+    TimerWheel wheel;
+    int firstTime = parsed.events.empty() ? 0 : parsed.events.front().get_time();
+    for (const Event& ev : parsed.events) {
+        std::chrono::duration<double> offset(std::max(0, ev.get_time() - firstTime) / speed);
+        due.push_back(std::chrono::duration_cast<Clock::duration>(offset));
+        wheel.schedule((due.back() + REPLAY_TICK - Clock::duration(1)) / REPLAY_TICK, bodies.size());
+        bodies.push_back(buildEventBody(ev, activeUser));
+    }
+    parsed.events.clear();
+
+    receiptWindow.setAdaptive();
+
+    std::vector<Clock::duration> drift;
+    drift.reserve(bodies.size());
+    bool acknowledged = true;
+    Clock::time_point start = Clock::now();
+    std::thread scheduler([&]() {
+        std::vector<uint64_t> fired;
+        while (!wheel.empty() && acknowledged) {
+            std::this_thread::sleep_until(start + wheel.nextDeadline() * REPLAY_TICK);
+            fired.clear();
+            wheel.advance((Clock::now() - start) / REPLAY_TICK, [&](uint64_t id, uint64_t) { fired.push_back(id); });
+
+            // all but the last are only queued, the last one writes them out together
+            for (size_t i = 0; i < fired.size(); i++) {
+                int thisReceiptId = nextReceiptId++;
+                if (!receiptWindow.acquire(thisReceiptId)) {
+                    acknowledged = false;
+                    break;
+                }
+                StompFrame send(FrameType::SEND, bodies[fired[i]],
+                                {{"destination", dest},
+                                 {"filename", path},
+                                 {"receipt", std::to_string(thisReceiptId)}});
+                drift.push_back(Clock::now() - (start + due[fired[i]]));
+                if (i + 1 < fired.size())
+                    queueFrame(handler, send);
+                else
+                    sendFrame(handler, send);
+            }
+        }
+    });
+    scheduler.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (!acknowledged || !receiptWindow.drain()) {
+        std::cerr << "connection lost before all reports were acknowledged\n";
+        return;
+    }
+
+    std::cout << "Replayed " << drift.size() << " reports to " << gameName << " game at " << speed
+              << "x in " << seconds << "s\n";
+    if (!drift.empty()) {
+        std::sort(drift.begin(), drift.end());
+        auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        Clock::duration total(0);
+        for (Clock::duration d : drift)
+            total += d;
+        std::cout << "timer drift: mean " << ms(total / drift.size()) << "ms, p50 " << ms(drift[drift.size() / 2])
+                  << "ms, p99 " << ms(drift[(drift.size() * 99 + 99) / 100 - 1]) << "ms, max " << ms(drift.back())
+                  << "ms\n";
+    }
+}
+
+// registers the frame handlers on the connection, the frames themselves are
+// dispatched by whichever thread runs the connection's event loop
 static void listenToServer(ConnectionHandler& handler,
                            GameDB& db,
                            std::atomic<bool>& running,
@@ -99,56 +469,95 @@ static void listenToServer(ConnectionHandler& handler,
                            bool& receiptArrived,
                            std::mutex& receiptMtx,
                            std::condition_variable& receiptCv,
+                           ReceiptWindow& receiptWindow,
                            std::mutex& loginMtx,
                            std::condition_variable& loginCv,
                            std::string& loginError,
                            bool& loginResponseReceived)
 {
-    while (running && !shouldTerminate) {
-        std::string raw_str;
-        if (!handler.getFrameAscii(raw_str, '\0')) {
-            if (!disconnecting.load()) {
-                std::cerr << "recv failed (Error: End of file)\n";
-            }   
-        
-            else {
-                std::lock_guard<std::mutex> lock(receiptMtx);
-                receiptArrived = true;
-                receiptCv.notify_all();
-            }
-            break;
+    // connection closed by the server
+    auto onClose = [&]() {
+        // nothing in flight will be acknowledged any more
+        receiptWindow.close();
+
+        if (!disconnecting.load()) {
+            std::cerr << "recv failed (Error: End of file)\n";
+        }   
+    
+        else {
+            std::lock_guard<std::mutex> lock(receiptMtx);
+            receiptArrived = true;
+            receiptCv.notify_all();
         }
+    };
+
+    // frames are parsed while they arrive, so a frame split over many reads is scanned once
+    auto parser = std::make_shared<StompParser>();
+    auto splitter = [parser](std::string_view pending) {
+        return parser->parse(pending);
+    };
 
-        // constructor expects STOMP frame string
-        StompFrame frame(raw_str + '\0');
+    // runs on the event loop thread for every frame, returns false to stop reading
+    auto onFrame = [&, parser](std::string_view raw, const ConnectionHandler::Slab& slab) -> bool {
+        // already parsed by the splitter, the frame views the receive buffer
+        StompFrameView frame(raw, parser->frame(), slab);
 
         if (frame.getType() == FrameType::MESSAGE) {
-            std::string dest = frame.getHeaderValue("destination");
+            std::string_view dest = frame.getHeaderValue(HeaderKey::DESTINATION);
             if (dest.empty()) 
-				continue;
+				return running && !shouldTerminate;
 
             std::string gameName = getGameFromDestination(dest);
 
-            std::string body = frame.getBody();
-            std::string msgUser = getUserFromBody(body, activeUser);
-
-            // parse body into Event
-            Event e(body);
-
-            // keep event for summary
-            db.addEvent(gameName,
-                        msgUser,
-                        e.get_team_a_name(),
-                        e.get_team_b_name(),
-                        e.get_game_updates(),
-                        e.get_team_a_updates(),
-                        e.get_team_b_updates(),
-                        e.get_time(),
-                        e.get_name(),
-                        e.get_description());
+            auto addEvent = [&](std::string_view body) {
+                std::string msgUser = getUserFromBody(body, activeUser);
+
+                // parse body into Event (the only copy of the body we keep); a malformed one is skipped
+                // rather than let the exception out of the event loop
+                Event e{std::string_view()};
+                try {
+                    e = Event{body};
+                } catch (const std::exception& ex) {
+                    std::cerr << "skipping a malformed event from " << dest << ": " << ex.what() << "\n";
+                    return;
+                }
+
+                // keep event for summary
+                db.addEvent(gameName,
+                            msgUser,
+                            e.get_team_a_name(),
+                            e.get_team_b_name(),
+                            e.get_game_updates(),
+                            e.get_team_a_updates(),
+                            e.get_team_b_updates(),
+                            e.get_time(),
+                            e.get_name(),
+                            e.get_description());
+            };
+
+            std::string_view batchCount = frame.getHeaderValue(HeaderKey::BATCH_COUNT);
+            if (batchCount.empty()) {
+                addEvent(frame.getBody());
+            }
+            else {
+                // several events in one frame, each a length-prefixed record. A record takes at least
+                // two bytes ("0\n"), so a count the body cannot hold is as malformed as one that is not a number
+                size_t count = 0;
+                auto parsed = std::from_chars(batchCount.data(), batchCount.data() + batchCount.size(), count);
+                if (parsed.ec != std::errc() || parsed.ptr != batchCount.data() + batchCount.size() ||
+                    count == 0 || count > frame.getBody().size() / 2)
+                    std::cerr << "malformed batch-count header from " << dest << ": " << batchCount << "\n";
+                else if (!forEachBatchRecord(frame.getBody(), count, addEvent))
+                    std::cerr << "malformed batch from " << dest << "\n";
+            }
         }
         else if (frame.getType() == FrameType::RECEIPT) {
-            std::string receiptId = frame.getHeaderValue("receipt-id");
+            std::string_view receiptId = frame.getHeaderValue(HeaderKey::RECEIPT_ID);
+
+            // receipts for report's SENDs come back in any order and just free their slot
+            if (receiptWindow.retire(receiptId))
+                return running && !shouldTerminate;
+
             std::string expectedCopy;
             {
                     std::lock_guard<std::mutex> lock(receiptMtx);
@@ -172,8 +581,8 @@ static void listenToServer(ConnectionHandler& handler,
             loginCv.notify_all();
         }
         else if (frame.getType() == FrameType::ERROR) {
-            std::string errorBody = frame.getBody();
-            std::string errorMsg = frame.getHeaderValue("message");
+            std::string_view errorBody = frame.getBody();
+            std::string_view errorMsg = frame.getHeaderValue("message");
             
             if (errorMsg.find("User already logged in") != std::string::npos) {
                 std::cerr << "User already logged in" << std::endl;
@@ -191,19 +600,35 @@ static void listenToServer(ConnectionHandler& handler,
             {
                 std::lock_guard<std::mutex> lock(loginMtx);
                 loginResponseReceived = true;
-                loginError = errorMsg.empty() ? errorBody : errorMsg;
+                loginError = std::string(errorMsg.empty() ? errorBody : errorMsg);
             }
             loginCv.notify_all();
+            receiptWindow.close();
             running = false;
-            break;
+            return false;
         }
-    }
+        return running && !shouldTerminate;
+    };
+
+    handler.startAsyncRead(splitter, onFrame, onClose);
 }
 
 int main(int argc, char *argv[]) {
 
     GameDB db;
 
+    // StompClient [--report-cache=DIR]: with DIR, report's cache is also kept there across runs
+    ReportCache reportCache;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--report-cache=", 0) == 0 && arg.size() > 15) {
+            reportCache.setDirectory(arg.substr(15));
+        } else {
+            std::cerr << "unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
     std::atomic<bool> running(true);
     std::atomic<bool> shouldTerminate(false);
 
@@ -220,6 +645,8 @@ int main(int argc, char *argv[]) {
     bool receiptArrived = false;
     std::string expectedReceiptId = "";
     int nextReceiptId = 1;
+    int nextTransactionId = 1;
+    ReceiptWindow receiptWindow;
 
     std::mutex loginMtx;
     std::condition_variable loginCv;
@@ -239,7 +666,7 @@ int main(int argc, char *argv[]) {
         std::getline(iss, cmd, ' '); //start reading line, stop when you see a space, store that in "cmd"
 
         if (cmd == "login") {
-            // login command = login {host:port} {user} {pass}
+            // login command = login {host:port | unix:path} {user} {pass} [socket options]
             if (handler != nullptr) {
                 std::cerr << "The client is already logged in, log out before trying again\n";
                 continue;
@@ -250,15 +677,36 @@ int main(int argc, char *argv[]) {
             std::getline(iss, user, ' ');  //store from there until the next space in "user"
             std::getline(iss, pass);  //store from there the rest in "pass"
 
+            // optional socket tuning after the password, e.g. "... pass --sndbuf=262144 --nodelay=0"
+            ConnectionHandler::SocketOptions socketOptions;
+            ConnectionHandler::Transport transport = ConnectionHandler::Transport::BOOST;
+            ConnectionHandler::FlushPolicy flushPolicy;
+            size_t optionsPos = pass.find(" --");
+            if (optionsPos != std::string::npos) {
+                std::string optionsStr = pass.substr(optionsPos + 1);
+                pass = pass.substr(0, optionsPos);
+                if (!parseSocketOptions(optionsStr, socketOptions, transport, flushPolicy))
+                    continue;
+            }
 
-            size_t pos = hostport.find(':');
-            if (pos == std::string::npos) {
-                std::cerr << "bad host:port\n";
-                continue;
+
+            std::string host;
+            unsigned short port = 0;
+            bool local = hostport.compare(0, ConnectionHandler::UNIX_PREFIX.size(), ConnectionHandler::UNIX_PREFIX) == 0;
+            if (local) {
+                // unix:/path/to/sock - broker on the same machine, the handler takes the whole target
+                host = hostport;
             }
+            else {
+                size_t pos = hostport.find(':');
+                if (pos == std::string::npos) {
+                    std::cerr << "bad host:port\n";
+                    continue;
+                }
 
-            std::string host = hostport.substr(0, pos);
-            short port = (short) std::stoi(hostport.substr(pos + 1));
+                host = hostport.substr(0, pos);
+                port = (unsigned short) std::stoi(hostport.substr(pos + 1));
+            }
 
             // create the connection
             if (handler != nullptr) {
@@ -267,27 +715,31 @@ int main(int argc, char *argv[]) {
                 handler = nullptr;
             }
 
-            handler = new ConnectionHandler(host, port);
+            handler = new ConnectionHandler(host, port, socketOptions, transport);
             if (!handler->connect()) {
                 std::cerr << "Could not connect to server" << std::endl;
                 delete handler;
                 handler = nullptr;
                 continue;
             }
+            handler->setFlushPolicy(flushPolicy);
 
             activeUser = user;
+            receiptWindow.reset();
 
-            // start listener thread
+            // start listener thread (runs the connection's event loop)
             if (!serverThread.joinable()) {
-                serverThread = std::thread([&](){
-                    listenToServer(*handler, db, running, shouldTerminate, activeUser, expectedReceiptId, receiptArrived, receiptMtx, receiptCv, loginMtx, loginCv, loginError, loginResponseReceived);
+                listenToServer(*handler, db, running, shouldTerminate, activeUser, expectedReceiptId, receiptArrived, receiptMtx, receiptCv, receiptWindow, loginMtx, loginCv, loginError, loginResponseReceived);
+                ConnectionHandler* loopHandler = handler;
+                serverThread = std::thread([loopHandler](){
+                    loopHandler->run();
                 });
             }
 
             // send CONNECT frame
             std::vector<StompFrame::Header> headers;
             headers.push_back({"accept-version", "1.2"});
-            headers.push_back({"host", host});
+            headers.push_back({"host", local ? "localhost" : host});
             headers.push_back({"login", user});
             headers.push_back({"passcode", pass});
 
@@ -370,10 +822,29 @@ int main(int argc, char *argv[]) {
             if (handler == nullptr) { std::cerr << "login first\n"; 
 				continue; }
 
-            // report command looks like : {file}
+            // report command looks like : {file} [report options]
             std::string jsonFile;
             std::getline(iss, jsonFile);  //store the line after the first space as "jsonFile"
 
+            // or report --follow {feed} [--window=N|auto], for an NDJSON feed that is still being written;
+            // its lines go out one SEND each as they come, so --batch and --transaction do not apply
+            bool follow = jsonFile.compare(0, 9, "--follow ") == 0;
+            if (follow)
+                jsonFile = jsonFile.substr(8);
+
+            ReportOptions reportOptions;
+            size_t optionsPos = jsonFile.find(" --");
+            if (optionsPos != std::string::npos) {
+                std::string optionsStr = jsonFile.substr(optionsPos + 1);
+                jsonFile = jsonFile.substr(0, optionsPos);
+                if (!parseReportOptions(optionsStr, reportOptions))
+                    continue;
+            }
+            if (follow && (reportOptions.batchSize != 1 || reportOptions.transactional)) {
+                std::cerr << "--batch and --transaction cannot be used with --follow\n";
+                continue;
+            }
+
             jsonFile = trim(jsonFile);
 
 
@@ -386,50 +857,240 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            names_and_events parsed = parseEventsFile(jsonFile);
+            if (follow) {
+                followFeed(*handler, jsonFile, reportOptions, activeUser, gameToSubId, receiptWindow, nextReceiptId);
+                continue;
+            }
+
+            // an unchanged file this user reported before is sent from the cache: no parsing, no formatting
+            ReportCache::Key cacheKey;
+            bool cacheable = ReportCache::keyFor(jsonFile, activeUser, cacheKey);
+            std::shared_ptr<const ReportCache::Entry> cached = cacheable ? reportCache.find(cacheKey) : nullptr;
+
+            // otherwise a parser thread streams the file's events into a bounded queue while this thread
+            // sends, so the first SEND leaves as soon as the first event is read
+            BoundedQueue<Event> events(REPORT_QUEUE_CAPACITY);
+            std::promise<std::pair<std::string, std::string>> teams;
+            std::future<std::pair<std::string, std::string>> teamsKnown = teams.get_future();
+            std::exception_ptr parseError;
+            std::thread parserThread;
+            if (!cached) parserThread = std::thread([&]() {
+                bool teamsSet = false;
+                try {
+                    parseEventsFile(jsonFile,
+                                    [&](const std::string& teamA, const std::string& teamB) {
+                                        teams.set_value(std::make_pair(teamA, teamB));
+                                        teamsSet = true;
+                                    },
+                                    [&](Event&& ev) { return events.push(std::move(ev)); });
+                } catch (...) {
+                    parseError = std::current_exception();
+                    if (!teamsSet)
+                        teams.set_exception(parseError);
+                }
+                events.close();
+            });
+
+            // closes the queue; the parser stops at its next event
+            auto stopParser = [&]() {
+                if (!parserThread.joinable())
+                    return;
+                events.close();
+                parserThread.join();
+            };
+            // why the parser could not read the file, once it stopped
+            auto parseFailure = [&]() -> std::string {
+                try { std::rethrow_exception(parseError); }
+                catch (const std::exception& e) { return e.what(); }
+                catch (...) { return "unknown error"; }
+            };
+
             // Use the same game name the user joined
             // Assume user joined with team_a_team_b format
-            std::string gameName =
-                parsed.team_a_name + "_" + parsed.team_b_name;
-
+            std::pair<std::string, std::string> names;
+            std::string gameName;
+            try {
+                names = cached ? std::make_pair(cached->teamA, cached->teamB) : teamsKnown.get();
+                gameName = names.first + "_" + names.second;
+            } catch (const std::exception&) {
+                // reported below, once the parser thread is done
+            }
 
-            if (gameToSubId.find(gameName) == gameToSubId.end()) {
+            if (!gameName.empty() && gameToSubId.find(gameName) == gameToSubId.end()) {
                 std::cerr << "You must join " << gameName << " before reporting.\n";
+                gameName.clear();
+            }
+            if (gameName.empty()) {
+                stopParser();
+                if (parseError)
+                    std::cerr << "could not read " << jsonFile << ": " << parseFailure() << "\n";
                 continue;
             }
             
             std::string dest = "/topic/" + gameName;
 
-            for (const Event& ev : parsed.events) {
-                std::string body = buildEventBody(ev, activeUser);
-
-                // prepare unique receipt id for this SEND and wait for it
-                std::string thisReceiptId;
-                {
-                    std::lock_guard<std::mutex> lock(receiptMtx);
-                    receiptArrived = false;
-                    thisReceiptId = std::to_string(nextReceiptId++);
-                    expectedReceiptId = thisReceiptId;
+            // keep up to window SENDs waiting for their receipt instead of one round trip per event
+            if (reportOptions.window == 0)
+                receiptWindow.setAdaptive();
+            else
+                receiptWindow.setLimit(reportOptions.window);
+
+            // each SEND carries batchSize events; with several, they go as length-prefixed records.
+            // nextSend takes them off the queue and returns false once the file is exhausted
+            size_t eventsPerSend = reportOptions.batchSize;
+            std::string sendBody;
+            size_t sendEvents = 0;
+            size_t eventsRead = 0;  // all sent once the loop below runs out of them
+
+            // on a miss the bodies are kept as they are built, for the cache; a file too big for the
+            // cache's budget is not collected
+            std::shared_ptr<ReportCache::Entry> built;
+            if (cacheable && !cached)
+                built = std::make_shared<ReportCache::Entry>();
+            size_t builtBytes = 0;
+            size_t nextCached = 0;
+            // the next event's body, false once the file is exhausted
+            auto nextBody = [&](std::string& body) {
+                if (cached) {
+                    if (nextCached == cached->bodies.size())
+                        return false;
+                    body = cached->bodies[nextCached++];
+                    return true;
                 }
-
+                Event ev{std::string_view()};  // empty until popped into
+                if (!events.pop(ev))
+                    return false;
+                body = buildEventBody(ev, activeUser);
+                if (built) {
+                    builtBytes += body.size();
+                    if (builtBytes > reportCache.getBudget())
+                        built.reset();
+                    else
+                        built->bodies.push_back(body);
+                }
+                return true;
+            };
+            auto nextSend = [&]() {
+                sendBody.clear();
+                sendEvents = 0;
+                std::string body;
+                while (sendEvents < eventsPerSend && nextBody(body)) {
+                    if (eventsPerSend == 1)
+                        sendBody.swap(body);
+                    else
+                        appendBatchRecord(sendBody, body);
+                    sendEvents++;
+                }
+                eventsRead += sendEvents;
+                return sendEvents > 0;
+            };
+            auto buildSend = [&](const StompFrame::Header& extra) {
                 std::vector<StompFrame::Header> headers;
                 headers.push_back({"destination", dest});
                 headers.push_back({"filename", jsonFile});
-                headers.push_back({"receipt", thisReceiptId});
+                headers.push_back(extra);
+                if (eventsPerSend > 1) {
+                    headers.push_back({"batch-count", std::to_string(sendEvents)});
+                    headers.push_back({"content-length", std::to_string(sendBody.size())});
+                }
+                return StompFrame(FrameType::SEND, sendBody, headers);
+            };
+
+            bool acknowledged = true;
+            bool haveSend = nextSend();
+            while (haveSend) {
+                // unique receipt id for this SEND (or COMMIT), tracked before sending so its receipt can't come first
+                int thisReceiptId = nextReceiptId++;
+                if (!receiptWindow.acquire(thisReceiptId)) {
+                    acknowledged = false;
+                    break;
+                }
 
-                StompFrame sendF(FrameType::SEND, body, headers);
-                sendFrame(*handler, sendF);
+                if (!reportOptions.transactional) {
+                    sendFrame(*handler, buildSend({"receipt", std::to_string(thisReceiptId)}));
+                    haveSend = nextSend();
+                    continue;
+                }
 
-                // Block until server acknowledges processing (DB logging + publish)
-                {
-                    std::unique_lock<std::mutex> lock(receiptMtx);
-                    receiptCv.wait(lock, [&] { return receiptArrived; });
+                // with transactions the server acknowledges once per COMMIT instead of once per SEND.
+                // BEGIN and the SENDs are only queued, the COMMIT writes out what is still waiting. Every
+                // TRANSACTION_QUEUE_FRAMES-th SEND is written with a blocking send instead, which waits for
+                // the queue in front of it, so memory stays bounded however long the transaction is
+                std::string transactionId = "tx-" + std::to_string(nextTransactionId++);
+                queueFrame(*handler, StompProtocol::buildBeginFrame(transactionId));
+
+                size_t inTransaction = 0;
+                while (haveSend && (reportOptions.transactionSize == 0 || inTransaction < reportOptions.transactionSize)) {
+                    if ((inTransaction + 1) % TRANSACTION_QUEUE_FRAMES == 0)
+                        sendFrame(*handler, buildSend({"transaction", transactionId}));
+                    else
+                        queueFrame(*handler, buildSend({"transaction", transactionId}));
+                    inTransaction++;
+                    haveSend = nextSend();
                 }
+
+                sendFrame(*handler, StompProtocol::buildCommitFrame(transactionId, std::to_string(thisReceiptId)));
+            }
+
+            // the parser may still be blocked on a full queue if sending stopped early
+            stopParser();
+
+            // every event of the file was read and sent: cache the bodies, unless the file changed meanwhile
+            ReportCache::Key keyAfter;
+            if (built && !haveSend && !parseError && ReportCache::keyFor(jsonFile, activeUser, keyAfter) &&
+                keyAfter == cacheKey) {
+                built->teamA = names.first;
+                built->teamB = names.second;
+                reportCache.store(cacheKey, built);
+            }
+
+            // Block until server acknowledges processing (DB logging + publish) of everything sent
+            if (!acknowledged || !receiptWindow.drain()) {
+                std::cerr << "connection lost before all reports were acknowledged\n";
+                continue;
+            }
+
+            // a file that breaks off midway: what came before it was sent and acknowledged
+            if (parseError) {
+                std::cerr << "could not read " << jsonFile << ": " << parseFailure() << "; sent " << eventsRead
+                          << " events to " << gameName << " before it\n";
+                continue;
             }
 
             std::cout << "Sent reports to " << gameName << " game\n";
         }
 
+        else if (cmd == "replay") {
+            if (handler == nullptr) { std::cerr << "login first\n";
+				continue; }
+
+            // replay command looks like : {file} {speed}, the file name may hold spaces
+            std::string args;
+            std::getline(iss, args);
+            args = trim(args);
+            size_t speedPos = args.find_last_of(' ');
+            if (speedPos == std::string::npos) {
+                std::cerr << "usage: replay {file} {speed}\n";
+                continue;
+            }
+            std::string file = trim(args.substr(0, speedPos));
+            double speed = 0;
+            try {
+                speed = std::stod(args.substr(speedPos + 1));
+            } catch (const std::exception&) {
+            }
+            if (!(speed > 0) || !std::isfinite(speed)) {
+                std::cerr << "bad replay speed: " << args.substr(speedPos + 1) << "\n";
+                continue;
+            }
+
+            if (gameToSubId.empty()) {
+                std::cerr << "You must join a game before reporting.\n";
+                continue;
+            }
+            replayFile(*handler, file, speed, activeUser, gameToSubId, receiptWindow, nextReceiptId);
+        }
+
         else if (cmd == "summary") {
             // summary command looks like: summary{game} {user} {file}
             std::string game, user, outFile;
@@ -461,7 +1122,7 @@ int main(int argc, char *argv[]) {
                     "",
                     {{"id", pair.second}}
                 );
-                sendFrame(*handler, unsub);
+                queueFrame(*handler, unsub);
             }
             gameToSubId.clear();
 
@@ -1,77 +1,84 @@
 #include "../include/StompFrame.h"
+#include "../include/StompParser.h"
 
 StompFrame::StompFrame(FrameType type, const std::string& body, const std::vector<Header>& headers)
-    : type(type), body(body), headers(headers) {}
+    : type(type), known(), knownMask(0), headers(), body(body) {
+    for (const auto& header : headers) {
+        addHeader(stringToHeaderKey(header.key), header.key, header.value);
+    }
+}
 
-StompFrame::StompFrame(const std::string& rawFrame) {
+StompFrame::StompFrame(const std::string& rawFrame) : type(), known(), knownMask(0), headers(), body() {
     // Remove trailing null terminator if present
-    std::string frame = rawFrame;
+    std::string_view frame = rawFrame;
     if (!frame.empty() && frame.back() == '\0') {
-        frame.pop_back();
+        frame.remove_suffix(1);
     }
-    
-    size_t currentPosition = 0;
-    
-    // Parse frame type (first line)
-    size_t firstNewline = frame.find('\n', currentPosition);
-    if (firstNewline < frame.length()) {  // check if position is valid
-        std::string typeStr = frame.substr(currentPosition, firstNewline - currentPosition);
-        type = stringToFrameType(typeStr);
-        currentPosition = firstNewline + 1;
-    }
-    
-    // Parse headers (until empty line)
-    while (currentPosition < frame.length()) {
-        size_t lineEnd = frame.find('\n', currentPosition);
-        
-        std::string line = frame.substr(currentPosition, lineEnd - currentPosition);
-        currentPosition = lineEnd + 1;
-        
-        // check if the line is a header
-        if (line.empty()) {
-            break;
-        }
-        
-        // Split on first colon
-        size_t colonPos = line.find(':');
-        if (colonPos < line.length()) {  // check if position is valid
-            std::string key = line.substr(0, colonPos);
-            std::string value = line.substr(colonPos + 1);
-            headers.push_back(Header(key, value));
-        }
+
+    StompParser parser;
+    parser.parse(frame, true);
+    const StompParser::Result& parsed = parser.frame();
+
+    type = parsed.type;
+    for (const auto& header : parsed.headers) {
+        addHeader(header.id, std::string(header.key.in(frame)), std::string(header.value.in(frame)));
     }
-    
-    // Parse body (everything after headers)
-    if (currentPosition < frame.length()) {
-        body = frame.substr(currentPosition);
-        if (body.back() == '\n') {
-            body.pop_back();
-        }
+    body = std::string(parsed.body.in(frame));
+}
+
+void StompFrame::addHeader(HeaderKey id, const std::string& key, const std::string& value) {
+    size_t slot = static_cast<size_t>(id);
+    if (id != HeaderKey::OTHER && !(knownMask & (1u << slot))) {
+        known[slot] = value;
+        knownMask |= 1u << slot;
     } else {
-        body = "";
+        headers.push_back(Header(key, value));
     }
 }
 
-std::string StompFrame::toString() const {
-    std::string result;
-    
+size_t StompFrame::serializedSize() const {
+    // command line, blank line, body, its newline and the terminator
+    size_t size = frameTypeToString(type).size() + 1 + 1 + body.size() + (hasHeader(HeaderKey::CONTENT_LENGTH) ? 0 : 1) + 1;
+    forEachHeader([&size](const std::string& key, const std::string& value) {
+        size += key.size() + 1 + value.size() + 1;
+    });
+    return size;
+}
+
+void StompFrame::appendTo(std::string& out) const {
+    // Only grows the buffer when this frame is larger than any before it
+    out.reserve(out.size() + serializedSize());
+
     // Frame type
-    result += frameTypeToString(type) + "\n";
-    
+    out.append(frameTypeToString(type));
+    out.push_back('\n');
+
     // Headers
-    for (const auto& header : headers) {
-        result += header.key + ":" + header.value + "\n";
-    }
-    
+    forEachHeader([&out](const std::string& key, const std::string& value) {
+        out.append(key);
+        out.push_back(':');
+        out.append(value);
+        out.push_back('\n');
+    });
+
     // Empty line before body
-    result += "\n";
-    
-    // Body
-    result += body + "\n";
-    
+    out.push_back('\n');
+
+    // Body, followed by a newline unless content-length says exactly where it ends
+    out.append(body);
+    if (!hasHeader(HeaderKey::CONTENT_LENGTH)) {
+        out.push_back('\n');
+    }
+
     // Null terminator
-    //result += '\0';
-    
+    out.push_back('\0');
+}
+
+std::string StompFrame::toString() const {
+    std::string result;
+    appendTo(result);
+    // without the null terminator, sendFrameAscii adds it
+    result.pop_back();
     return result;
 }
 
@@ -87,11 +94,26 @@ const std::vector<StompFrame::Header>& StompFrame::getHeaders() const {
     return headers;
 }
 
-std::string StompFrame::getHeaderValue(const std::string& key) const {
+// returned by reference for missing headers
+static const std::string emptyValue;
+
+const std::string& StompFrame::getHeaderValue(HeaderKey key) const {
+    return hasHeader(key) ? known[static_cast<size_t>(key)] : emptyValue;
+}
+
+bool StompFrame::hasHeader(HeaderKey key) const {
+    return key != HeaderKey::OTHER && (knownMask & (1u << static_cast<size_t>(key)));
+}
+
+const std::string& StompFrame::getHeaderValue(const std::string& key) const {
+    HeaderKey id = stringToHeaderKey(key);
+    if (id != HeaderKey::OTHER) {
+        return getHeaderValue(id);
+    }
     for (const auto& header : headers) {
         if (header.key == key) {
             return header.value;
         }
     }
-    return "";
-}
\ No newline at end of file
+    return emptyValue;
+}
@@ -0,0 +1,76 @@
+#include "../include/StompFrameView.h"
+
+#include <string>
+
+StompFrameView::StompFrameView(std::string_view rawFrame, std::shared_ptr<const void> storage)
+    : type(), known(), knownMask(0), headers(), body(), storage(std::move(storage)) {
+    std::string_view frame = rawFrame;
+    if (!frame.empty() && frame.back() == '\0') {
+        frame.remove_suffix(1);
+    }
+
+    StompParser parser;
+    parser.parse(frame, true);
+    assign(frame, parser.frame());
+}
+
+StompFrameView::StompFrameView(std::string_view rawFrame, const StompParser::Result& parsed,
+                               std::shared_ptr<const void> storage)
+    : type(), known(), knownMask(0), headers(), body(), storage(std::move(storage)) {
+    assign(rawFrame, parsed);
+}
+
+void StompFrameView::assign(std::string_view frame, const StompParser::Result& parsed) {
+    type = parsed.type;
+    for (const auto& header : parsed.headers) {
+        size_t slot = static_cast<size_t>(header.id);
+        if (header.id != HeaderKey::OTHER && !(knownMask & (1u << slot))) {
+            known[slot] = header.value.in(frame);
+            knownMask |= 1u << slot;
+        } else {
+            headers.push_back(HeaderView{header.key.in(frame), header.value.in(frame)});
+        }
+    }
+    body = parsed.body.in(frame);
+}
+
+FrameType StompFrameView::getType() const {
+    return type;
+}
+
+std::string_view StompFrameView::getBody() const {
+    return body;
+}
+
+const std::vector<StompFrameView::HeaderView>& StompFrameView::getHeaders() const {
+    return headers;
+}
+
+std::string_view StompFrameView::getHeaderValue(HeaderKey key) const {
+    return hasHeader(key) ? known[static_cast<size_t>(key)] : std::string_view();
+}
+
+bool StompFrameView::hasHeader(HeaderKey key) const {
+    return key != HeaderKey::OTHER && (knownMask & (1u << static_cast<size_t>(key)));
+}
+
+std::string_view StompFrameView::getHeaderValue(std::string_view key) const {
+    HeaderKey id = stringToHeaderKey(key);
+    if (id != HeaderKey::OTHER) {
+        return getHeaderValue(id);
+    }
+    for (const auto& header : headers) {
+        if (header.key == key) {
+            return header.value;
+        }
+    }
+    return std::string_view();
+}
+
+StompFrame StompFrameView::toFrame() const {
+    std::vector<StompFrame::Header> owned;
+    forEachHeader([&owned](std::string_view key, std::string_view value) {
+        owned.push_back(StompFrame::Header(std::string(key), std::string(value)));
+    });
+    return StompFrame(type, std::string(body), owned);
+}
@@ -0,0 +1,131 @@
+#include "../include/StompParser.h"
+#include "../include/StructuralScanner.h"
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+StompParser::StompParser()
+    : state(State::COMMAND), scanned(0), lineStart(0), lineColon(StructuralScanner::npos), contentLength(UNKNOWN_LENGTH), result() {}
+
+void StompParser::reset() {
+    state = State::COMMAND;
+    scanned = 0;
+    lineStart = 0;
+    lineColon = StructuralScanner::npos;
+    contentLength = UNKNOWN_LENGTH;
+    result.headers.clear();
+    result.body = Range{0, 0};
+    result.length = 0;
+}
+
+const StompParser::Result& StompParser::frame() const {
+    return result;
+}
+
+size_t StompParser::parse(std::string_view data, bool endOfInput) {
+    if (state == State::DONE) {
+        reset();
+    }
+
+    // Walk the '\n', ':' and '\0' positions of the lines not looked at yet
+    StructuralScanner scanner(data, scanned);
+    while (state != State::BODY) {
+        // Command and header lines end at '\n'; a '\0' here ends a frame without a body.
+        size_t lineEnd = scanner.next();
+        while (lineEnd != StructuralScanner::npos && data[lineEnd] == ':') {
+            if (lineColon == StructuralScanner::npos) {
+                lineColon = lineEnd;
+            }
+            lineEnd = scanner.next();
+        }
+        if (lineEnd == StructuralScanner::npos) {
+            if (!endOfInput) {
+                scanned = data.size();
+                return 0;
+            }
+            lineEnd = data.size();
+        }
+        bool frameEnds = lineEnd == data.size() || data[lineEnd] == '\0';
+
+        size_t lineLength = lineEnd - lineStart;
+        if (lineLength > 0 && data[lineEnd - 1] == '\r') {
+            lineLength--;
+        }
+        std::string_view line = data.substr(lineStart, lineLength);
+
+        if (state == State::COMMAND) {
+            result.type = stringToFrameType(line);
+            state = State::HEADERS;
+        } else if (line.empty()) {
+            // Blank line: the body starts right after it
+            result.body = Range{lineEnd + 1, 0};
+            scanned = lineEnd + 1;
+            state = State::BODY;
+            break;
+        } else {
+            // Split on first colon
+            if (lineColon != StructuralScanner::npos) {
+                size_t colonPos = lineColon - lineStart;
+                HeaderKey id = stringToHeaderKey(line.substr(0, colonPos));
+                result.headers.push_back(HeaderRange{Range{lineStart, colonPos},
+                                                     Range{lineStart + colonPos + 1, lineLength - colonPos - 1}, id});
+                if (contentLength == UNKNOWN_LENGTH && id == HeaderKey::CONTENT_LENGTH) {
+                    std::string_view value = line.substr(colonPos + 1);
+                    auto parsed = std::from_chars(value.data(), value.data() + value.size(), contentLength);
+                    if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size()) {
+                        contentLength = UNKNOWN_LENGTH;
+                        throw std::runtime_error("Malformed content-length: " + std::string(value));
+                    }
+                }
+            }
+        }
+
+        if (frameEnds) {
+            result.body = Range{lineEnd, 0};
+            result.length = lineEnd + 1;
+            state = State::DONE;
+            return result.length;
+        }
+        lineStart = scanned = lineEnd + 1;
+        lineColon = StructuralScanner::npos;
+    }
+
+    size_t bodyEnd;
+    if (contentLength != UNKNOWN_LENGTH) {
+        // Length known: jump straight to where the terminator has to be
+        if (contentLength >= std::numeric_limits<size_t>::max() - result.body.offset) {
+            throw std::runtime_error("Malformed content-length: " + std::to_string(contentLength));
+        }
+        bodyEnd = result.body.offset + contentLength;
+        if (bodyEnd >= data.size()) {
+            if (!(endOfInput && bodyEnd == data.size())) {
+                return 0;
+            }
+        } else if (data[bodyEnd] != '\0') {
+            throw std::runtime_error("Frame body does not end at content-length");
+        }
+        result.body.length = contentLength;
+    } else {
+        const void *found = std::memchr(data.data() + scanned, '\0', data.size() - scanned);
+        if (found == nullptr) {
+            if (!endOfInput) {
+                scanned = data.size();
+                return 0;
+            }
+            bodyEnd = data.size();
+        } else {
+            bodyEnd = static_cast<size_t>(static_cast<const char *>(found) - data.data());
+        }
+        // Without a length the body ends at the NUL, minus the newline toString() adds
+        result.body.length = bodyEnd - result.body.offset;
+        if (result.body.length > 0 && data[bodyEnd - 1] == '\n') {
+            result.body.length--;
+        }
+    }
+
+    result.length = bodyEnd + 1;
+    state = State::DONE;
+    return result.length;
+}
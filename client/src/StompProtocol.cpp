@@ -3,7 +3,7 @@
 #include <vector>
 
 StompProtocol::StompProtocol()
-    : nextReceiptId(1), nextSubscriptionId(1), isLoggedIn(false), currentUser("") {}
+    : nextReceiptId(1), nextSubscriptionId(1), isLoggedIn(false), currentUser(""), gameToSubscriptionId() {}
 
 StompProtocol::~StompProtocol() {}
 
@@ -18,7 +18,7 @@ StompFrame StompProtocol::buildConnectFrame(const std::string& host, const std::
     return StompFrame(FrameType::CONNECT, "", headers);
 }
 
-StompFrame StompProtocol::buildSendFrame(const std::string& destination, const std::string& body, const std::string& filename, const std::string& receiptId)
+StompFrame StompProtocol::buildSendFrame(const std::string& destination, const std::string& body, const std::string& filename, const std::string& receiptId, const std::string& transactionId)
 {
     std::vector<StompFrame::Header> headers;
     headers.push_back({"destination", destination});
@@ -31,9 +31,33 @@ StompFrame StompProtocol::buildSendFrame(const std::string& destination, const s
         headers.push_back({"receipt", receiptId});
     }
 
+    if (!transactionId.empty()) {
+        headers.push_back({"transaction", transactionId});
+    }
+
     return StompFrame(FrameType::SEND, body, headers);
 }
 
+StompFrame StompProtocol::buildBeginFrame(const std::string& transactionId)
+{
+    std::vector<StompFrame::Header> headers;
+    headers.push_back({"transaction", transactionId});
+
+    return StompFrame(FrameType::BEGIN, "", headers);
+}
+
+StompFrame StompProtocol::buildCommitFrame(const std::string& transactionId, const std::string& receiptId)
+{
+    std::vector<StompFrame::Header> headers;
+    headers.push_back({"transaction", transactionId});
+
+    if (!receiptId.empty()) {
+        headers.push_back({"receipt", receiptId});
+    }
+
+    return StompFrame(FrameType::COMMIT, "", headers);
+}
+
 StompFrame StompProtocol::buildSubscribeFrame(const std::string& destination, const std::string& subscriptionId)
 {
     std::vector<StompFrame::Header> headers;
@@ -132,9 +156,9 @@ bool StompProtocol::validateMessageFrame(const StompFrame& frame) const
         return false;
     }
     
-    std::string dest = frame.getHeaderValue("destination");
-    std::string subId = frame.getHeaderValue("subscription");
-    std::string msgId = frame.getHeaderValue("message-id");
+    const std::string& dest = frame.getHeaderValue(HeaderKey::DESTINATION);
+    const std::string& subId = frame.getHeaderValue(HeaderKey::SUBSCRIPTION);
+    const std::string& msgId = frame.getHeaderValue(HeaderKey::MESSAGE_ID);
     
     return !dest.empty() && !subId.empty() && !msgId.empty();
 }
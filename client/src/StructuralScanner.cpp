@@ -0,0 +1,145 @@
+#include "../include/StructuralScanner.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRUCTURAL_SCANNER_X86 1
+#endif
+
+namespace {
+
+uint64_t scanScalar(const char *block) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < StructuralScanner::BLOCK_BYTES; i++) {
+        char c = block[i];
+        if (c == '\n' || c == ':' || c == '\0') {
+            bits |= uint64_t(1) << i;
+        }
+    }
+    return bits;
+}
+
+#ifdef STRUCTURAL_SCANNER_X86
+uint64_t scanSse2(const char *block) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, colon)),
+                                    _mm_cmpeq_epi8(chunk, zero));
+        bits |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (16 * i);
+    }
+    return bits;
+}
+
+__attribute__((target("avx2")))
+uint64_t scanAvx2(const char *block) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t bits = 0;
+    for (int i = 0; i < 2; i++) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * i));
+        __m256i hits = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, colon)),
+                _mm256_cmpeq_epi8(chunk, zero));
+        bits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits))) << (32 * i);
+    }
+    return bits;
+}
+#endif
+
+bool supported(StructuralScanner::Isa isa) {
+#ifdef STRUCTURAL_SCANNER_X86
+    switch (isa) {
+        case StructuralScanner::Isa::AVX2: return __builtin_cpu_supports("avx2");
+        case StructuralScanner::Isa::SSE2: return __builtin_cpu_supports("sse2");
+        default: return true;
+    }
+#else
+    return isa == StructuralScanner::Isa::SCALAR;
+#endif
+}
+
+StructuralScanner::Isa best() {
+    if (supported(StructuralScanner::Isa::AVX2)) return StructuralScanner::Isa::AVX2;
+    if (supported(StructuralScanner::Isa::SSE2)) return StructuralScanner::Isa::SSE2;
+    return StructuralScanner::Isa::SCALAR;
+}
+
+uint64_t (*implementation(StructuralScanner::Isa isa))(const char *) {
+    switch (isa) {
+#ifdef STRUCTURAL_SCANNER_X86
+        case StructuralScanner::Isa::AVX2: return scanAvx2;
+        case StructuralScanner::Isa::SSE2: return scanSse2;
+#endif
+        default: return scanScalar;
+    }
+}
+
+// Chosen during static initialization, before any parsing
+StructuralScanner::Isa currentIsa = best();
+uint64_t (*currentScan)(const char *) = implementation(currentIsa);
+
+} // namespace
+
+StructuralScanner::StructuralScanner(std::string_view data, size_t from) : data(data), blockStart(0), bits(0) {
+    load(from);
+}
+
+void StructuralScanner::load(size_t start) {
+    blockStart = start;
+    if (start >= data.size()) {
+        bits = 0;
+        return;
+    }
+    size_t available = data.size() - start;
+    if (available >= BLOCK_BYTES) {
+        bits = currentScan(data.data() + start);
+        return;
+    }
+    // Last partial block: scan a padded copy and drop the bits past the end
+    char tail[BLOCK_BYTES];
+    std::memset(tail, ' ', BLOCK_BYTES);
+    std::memcpy(tail, data.data() + start, available);
+    bits = currentScan(tail) & ((uint64_t(1) << available) - 1);
+}
+
+size_t StructuralScanner::next() {
+    while (bits == 0) {
+        if (blockStart + BLOCK_BYTES >= data.size()) {
+            return npos;
+        }
+        load(blockStart + BLOCK_BYTES);
+    }
+    size_t position = blockStart + static_cast<size_t>(__builtin_ctzll(bits));
+    bits &= bits - 1;
+    return position;
+}
+
+uint64_t StructuralScanner::scanBlock(const char *block) {
+    return currentScan(block);
+}
+
+StructuralScanner::Isa StructuralScanner::getIsa() {
+    return currentIsa;
+}
+
+StructuralScanner::Isa StructuralScanner::setIsa(Isa isa) {
+    if (supported(isa)) {
+        currentIsa = isa;
+        currentScan = implementation(isa);
+    }
+    return currentIsa;
+}
+
+const char *StructuralScanner::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2: return "avx2";
+        case Isa::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,84 @@
+#include "../include/TimerWheel.h"
+
+#include <algorithm>
+
+static const uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+// the slot at level for tick
+static size_t slotIndex(unsigned level, uint64_t tick)
+{
+    return level * TimerWheel::SLOTS + ((tick >> (level * TimerWheel::SLOT_BITS)) & SLOT_MASK);
+}
+
+TimerWheel::TimerWheel() : slots(LEVELS * SLOTS), current(0), pending(0), added(0) {}
+
+void TimerWheel::place(const Timer &timer)
+{
+    uint64_t delay = timer.expiry - current;
+    for (unsigned level = 0; level < LEVELS; level++) {
+        if (delay < (uint64_t(1) << ((level + 1) * SLOT_BITS))) {
+            slots[slotIndex(level, timer.expiry)].push_back(timer);
+            return;
+        }
+    }
+    // beyond the last wheel: park it in the last wheel's farthest slot; when that slot is
+    // cascaded it is placed again from its real expiry
+    uint64_t farthest = current + (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+    slots[slotIndex(LEVELS - 1, farthest)].push_back(timer);
+}
+
+// moves the timers of level's current slot to finer wheels
+void TimerWheel::cascade(unsigned level)
+{
+    std::vector<Timer> moving;
+    moving.swap(slots[slotIndex(level, current)]);
+    for (const Timer &timer : moving)
+        place(timer);
+}
+
+void TimerWheel::schedule(uint64_t expiry, uint64_t id)
+{
+    place(Timer{expiry < current ? current : expiry, id, added++});
+    pending++;
+}
+
+void TimerWheel::advance(uint64_t tick, const std::function<void(uint64_t, uint64_t)> &onFire)
+{
+    while (current <= tick && pending > 0) {
+        // the finest wheel came round: bring down what is due during its next turn, and from each
+        // coarser wheel as well while the one below it wrapped too
+        if ((current & SLOT_MASK) == 0) {
+            for (unsigned level = 1; level < LEVELS; level++) {
+                cascade(level);
+                if (((current >> (level * SLOT_BITS)) & SLOT_MASK) != 0)
+                    break;
+            }
+        }
+
+        std::vector<Timer> due;
+        due.swap(slots[slotIndex(0, current)]);
+        // a timer that came down from a coarser wheel is behind any added to this slot directly,
+        // even ones added after it
+        auto bySequence = [](const Timer &a, const Timer &b) { return a.sequence < b.sequence; };
+        if (!std::is_sorted(due.begin(), due.end(), bySequence))
+            std::sort(due.begin(), due.end(), bySequence);
+        pending -= due.size();
+        for (const Timer &timer : due)
+            onFire(timer.id, timer.expiry);
+        current++;
+    }
+    // nothing left to fire: jump straight to tick
+    if (current <= tick)
+        current = tick + 1;
+}
+
+uint64_t TimerWheel::nextDeadline() const
+{
+    // on a wrap the coarser wheels have not been brought down yet
+    if ((current & SLOT_MASK) == 0)
+        return current;
+    for (uint64_t tick = current; (tick & SLOT_MASK) != 0; tick++)
+        if (!slots[slotIndex(0, tick)].empty())
+            return tick;
+    return (current | SLOT_MASK) + 1;
+}
@@ -10,7 +10,7 @@ int main (int argc, char *argv[]) {
         return -1;
     }
     std::string host = argv[1];
-    short port = atoi(argv[2]);
+    unsigned short port = atoi(argv[2]);
     
     ConnectionHandler connectionHandler(host, port);
     if (!connectionHandler.connect()) {
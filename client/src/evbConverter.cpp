@@ -0,0 +1,37 @@
+#include "../include/EventBinary.h"
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+// EvbConverter events.json [events.evb]: writes the events file in the binary format report
+// reads without parsing json. The output defaults to the input with .json replaced by .evb.
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " events.json [events.evb]" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output;
+    if (argc == 3) {
+        output = argv[2];
+    } else {
+        std::string extension = ".json";
+        bool hasExtension = input.size() > extension.size() &&
+                            input.compare(input.size() - extension.size(), extension.size(), extension) == 0;
+        output = (hasExtension ? input.substr(0, input.size() - extension.size()) : input) + ".evb";
+    }
+    if (output == input) {
+        std::cerr << "refusing to overwrite " << input << std::endl;
+        return 1;
+    }
+
+    try {
+        uint64_t events = convertEventsFile(input, output);
+        std::cout << "Wrote " << events << " events to " << output << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "cannot convert " << input << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,11 +1,20 @@
 #include "../include/event.h"
 #include "../include/json.hpp"
+#include "../include/StructuralScanner.h"
+#include "../include/EventsScanner.h"
+#include "../include/EventBinary.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <map>
 #include <vector>
 #include <sstream>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <exception>
 using json = nlohmann::json;
 
 Event::Event(std::string team_a_name, std::string team_b_name, std::string name, int time,
@@ -66,43 +75,61 @@ const std::string &Event::get_description() const
 //}
  */
 
-Event::Event(const std::string &frame_body)
+// the rest of line after prefix, without one leading space, if line starts with prefix
+static bool fieldValue(std::string_view line, std::string_view prefix, std::string_view &value)
+{
+    if (line.substr(0, prefix.size()) != prefix) return false;
+    value = line.substr(prefix.size());
+    if (!value.empty() && value[0] == ' ') value.remove_prefix(1);
+    return true;
+}
+
+Event::Event(std::string_view frame_body)
     : team_a_name(""), team_b_name(""), name(""), time(0),
       game_updates(), team_a_updates(), team_b_updates(), description("")
 {
-    std::istringstream iss(frame_body);
-    std::string line;
-
     enum Section { NONE, GENERAL, TEAM_A, TEAM_B, DESC };
     Section section = NONE;
 
-    while (std::getline(iss, line)) {
-        if (line.size() > 0 && line.back() == '\r') line.pop_back();
+    // lines end at '\n', and the scanner already tells where each line's first ':' is
+    StructuralScanner scanner(frame_body);
+    size_t lineStart = 0;
+    size_t colon = StructuralScanner::npos;
+
+    while (lineStart < frame_body.size()) {
+        size_t pos = scanner.next();
+        if (pos != StructuralScanner::npos && frame_body[pos] != '\n') {
+            if (frame_body[pos] == ':' && colon == StructuralScanner::npos) colon = pos;
+            continue;
+        }
+        size_t lineEnd = pos == StructuralScanner::npos ? frame_body.size() : pos;
+        std::string_view line = frame_body.substr(lineStart, lineEnd - lineStart);
+        size_t lineColon = colon == StructuralScanner::npos ? std::string_view::npos : colon - lineStart;
+        lineStart = lineEnd + 1;
+        colon = StructuralScanner::npos;
+
+        if (line.size() > 0 && line.back() == '\r') line.remove_suffix(1);
         if (line.empty()) continue;
 
         // main fields
-        if (line.rfind("team a:", 0) == 0) {
-            team_a_name = line.substr(std::string("team a:").size());
-            if (!team_a_name.empty() && team_a_name[0] == ' ') team_a_name.erase(0, 1);
+        std::string_view value;
+        if (fieldValue(line, "team a:", value)) {
+            team_a_name = std::string(value);
             section = NONE;
             continue;
         }
-        if (line.rfind("team b:", 0) == 0) {
-            team_b_name = line.substr(std::string("team b:").size());
-            if (!team_b_name.empty() && team_b_name[0] == ' ') team_b_name.erase(0, 1);
+        if (fieldValue(line, "team b:", value)) {
+            team_b_name = std::string(value);
             section = NONE;
             continue;
         }
-        if (line.rfind("event name:", 0) == 0) {
-            name = line.substr(std::string("event name:").size());
-            if (!name.empty() && name[0] == ' ') name.erase(0, 1);
+        if (fieldValue(line, "event name:", value)) {
+            name = std::string(value);
             section = NONE;
             continue;
         }
-        if (line.rfind("time:", 0) == 0) {
-            std::string t = line.substr(std::string("time:").size());
-            if (!t.empty() && t[0] == ' ') t.erase(0, 1);
-            time = std::stoi(t);
+        if (fieldValue(line, "time:", value)) {
+            time = std::stoi(std::string(value));
             section = NONE;
             continue;
         }
@@ -122,16 +149,15 @@ Event::Event(const std::string &frame_body)
 
         // key:value updates inside update sections
         if (section == GENERAL || section == TEAM_A || section == TEAM_B) {
-            size_t colon = line.find(':');
-            if (colon == std::string::npos) continue;
+            if (lineColon >= line.size()) continue;
 
-            std::string key = line.substr(0, colon);
-            std::string val = line.substr(colon + 1);
-            if (!val.empty() && val[0] == ' ') val.erase(0, 1);
+            std::string key(line.substr(0, lineColon));
+            std::string_view val = line.substr(lineColon + 1);
+            if (!val.empty() && val[0] == ' ') val.remove_prefix(1);
 
-            if (section == GENERAL) game_updates[key] = val;
-            if (section == TEAM_A)  team_a_updates[key] = val;
-            if (section == TEAM_B)  team_b_updates[key] = val;
+            if (section == GENERAL) game_updates[key] = std::string(val);
+            if (section == TEAM_A)  team_a_updates[key] = std::string(val);
+            if (section == TEAM_B)  team_b_updates[key] = std::string(val);
             continue;
         }
 
@@ -142,51 +168,400 @@ Event::Event(const std::string &frame_body)
 
 
 
-names_and_events parseEventsFile(std::string json_path)
+// converts one element of the "events" array
+static Event eventFromJson(json &event, const std::string &team_a_name, const std::string &team_b_name)
+{
+    std::string name = event["event name"];
+    int time = event["time"];
+    std::string description = event["description"];
+    std::map<std::string, std::string> game_updates;
+    std::map<std::string, std::string> team_a_updates;
+    std::map<std::string, std::string> team_b_updates;
+    for (auto &update : event["general game updates"].items())
+    {
+        if (update.value().is_string())
+            game_updates[update.key()] = update.value();
+        else
+            game_updates[update.key()] = update.value().dump();
+    }
+
+    for (auto &update : event["team a updates"].items())
+    {
+        if (update.value().is_string())
+            team_a_updates[update.key()] = update.value();
+        else
+            team_a_updates[update.key()] = update.value().dump();
+    }
+
+    for (auto &update : event["team b updates"].items())
+    {
+        if (update.value().is_string())
+            team_b_updates[update.key()] = update.value();
+        else
+            team_b_updates[update.key()] = update.value().dump();
+    }
+
+    return Event(team_a_name, team_b_name, name, time, game_updates, team_a_updates, team_b_updates, description);
+}
+
+bool parseEventLine(std::string_view line, std::string &team_a_name, std::string &team_b_name, Event &event)
+{
+    try
+    {
+        json object = json::parse(line);
+        if (!object.is_object())
+            throw std::runtime_error("not an object");
+        if (object.contains("team a"))
+            team_a_name = object["team a"].get<std::string>();
+        if (object.contains("team b"))
+            team_b_name = object["team b"].get<std::string>();
+        if (!object.contains("event name"))
+            return false;
+        event = eventFromJson(object, team_a_name, team_b_name);
+        return true;
+    }
+    catch (const json::exception &e)
+    {
+        throw std::runtime_error(e.what());
+    }
+}
+
+// SAX handler for parseEventsFile: only the event being read is held as a json value,
+// everything else is looked at once and dropped
+class EventsFileHandler : public nlohmann::json_sax<json>
+{
+private:
+    const std::function<void(const std::string &, const std::string &)> &onNames;
+    const std::function<bool(Event &&)> &onEvent;
+
+    std::string team_a_name;
+    std::string team_b_name;
+    bool has_team_a;
+    bool has_team_b;
+    std::vector<json> early_events;  // events seen before both team names, handed out once they are known
+
+    size_t depth;           // nesting of the value being read, the root object is 1
+    std::string top_key;    // key of the root object member being read
+    bool in_events;         // inside the "events" array
+    json current;           // event being built
+    std::vector<json *> open;  // containers of current still being filled
+    std::string pending_key;
+
+    bool namesKnown() const { return has_team_a && has_team_b; }
+
+    // puts v where the next value of current goes; returns where it ended up
+    json *add(json &&v)
+    {
+        if (open.empty())
+        {
+            current = std::move(v);
+            return &current;
+        }
+        json &parent = *open.back();
+        if (parent.is_object())
+            return &(parent[pending_key] = std::move(v));
+        parent.push_back(std::move(v));
+        return &parent.back();
+    }
+
+    bool building() const { return !open.empty(); }
+
+    bool emit(json &event)
+    {
+        if (!namesKnown())
+        {
+            early_events.push_back(std::move(event));
+            return true;
+        }
+        return onEvent(eventFromJson(event, team_a_name, team_b_name));
+    }
+
+    bool setName(const std::string &value)
+    {
+        if (top_key == "team a") { team_a_name = value; has_team_a = true; }
+        if (top_key == "team b") { team_b_name = value; has_team_b = true; }
+        if (!namesKnown() || (top_key != "team a" && top_key != "team b"))
+            return true;
+        onNames(team_a_name, team_b_name);
+        for (json &event : early_events)
+            if (!onEvent(eventFromJson(event, team_a_name, team_b_name)))
+                return false;
+        early_events.clear();
+        return true;
+    }
+
+    bool scalar(json &&v)
+    {
+        if (building())
+        {
+            add(std::move(v));
+            return true;
+        }
+        if (depth == 1 && v.is_string())
+            return setName(v.get<std::string>());
+        return true;
+    }
+
+    bool startContainer(json &&v)
+    {
+        depth++;
+        // an element of "events" starts
+        if (!building() && in_events && depth == 3 && v.is_object())
+            current = json();
+        if (building() || (in_events && depth == 3))
+        {
+            open.push_back(add(std::move(v)));
+            return true;
+        }
+        if (depth == 2 && top_key == "events" && v.is_array())
+            in_events = true;
+        return true;
+    }
+
+    bool endContainer()
+    {
+        depth--;
+        if (building())
+        {
+            open.pop_back();
+            if (!building())
+            {
+                bool more = emit(current);
+                current = json();
+                return more;
+            }
+            return true;
+        }
+        if (depth == 1)
+            in_events = false;
+        return true;
+    }
+
+public:
+    EventsFileHandler(const std::function<void(const std::string &, const std::string &)> &onNames,
+                      const std::function<bool(Event &&)> &onEvent)
+        : onNames(onNames), onEvent(onEvent), team_a_name(), team_b_name(), has_team_a(false), has_team_b(false),
+          early_events(), depth(0), top_key(), in_events(false), current(), open(), pending_key()
+    {
+    }
+
+    // both names never showed up: hand out what was held back with empty names
+    bool finish()
+    {
+        if (!namesKnown())
+        {
+            onNames(team_a_name, team_b_name);
+            for (json &event : early_events)
+                if (!onEvent(eventFromJson(event, team_a_name, team_b_name)))
+                    return false;
+        }
+        return true;
+    }
+
+    bool null() override { return scalar(json(nullptr)); }
+    bool boolean(bool val) override { return scalar(json(val)); }
+    bool number_integer(number_integer_t val) override { return scalar(json(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return scalar(json(val)); }
+    bool number_float(number_float_t val, const string_t &) override { return scalar(json(val)); }
+    bool string(string_t &val) override { return scalar(json(std::move(val))); }
+    bool binary(binary_t &val) override { return scalar(json::binary(std::move(val))); }
+    bool start_object(std::size_t) override { return startContainer(json::object()); }
+    bool end_object() override { return endContainer(); }
+    bool start_array(std::size_t) override { return startContainer(json::array()); }
+    bool end_array() override { return endContainer(); }
+
+    bool key(string_t &val) override
+    {
+        if (building())
+            pending_key = val;
+        else if (depth == 1)
+            top_key = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+    {
+        throw std::runtime_error(ex.what());
+    }
+};
+
+bool parseEventsFileGeneric(const std::string &json_path,
+                            const std::function<void(const std::string &, const std::string &)> &onNames,
+                            const std::function<bool(Event &&)> &onEvent)
 {
     std::ifstream f(json_path);
-    json data = json::parse(f);
-
-    std::string team_a_name = data["team a"];
-    std::string team_b_name = data["team b"];
-
-    // run over all the events and convert them to Event objects
-    std::vector<Event> events;
-    for (auto &event : data["events"])
-    {
-        std::string name = event["event name"];
-        int time = event["time"];
-        std::string description = event["description"];
-        std::map<std::string, std::string> game_updates;
-        std::map<std::string, std::string> team_a_updates;
-        std::map<std::string, std::string> team_b_updates;
-        for (auto &update : event["general game updates"].items())
+    if (!f)
+        throw std::runtime_error("cannot open " + json_path);
+
+    EventsFileHandler handler(onNames, onEvent);
+    if (!json::sax_parse(f, &handler))
+        return false;
+    return handler.finish();
+}
+
+bool parseEventsFile(const std::string &json_path,
+                     const std::function<void(const std::string &, const std::string &)> &onNames,
+                     const std::function<bool(Event &&)> &onEvent)
+{
+    bool namesSent = false;
+    size_t handedOut = 0;
+    {
+        MappedFile file(json_path);
+
+        // made by EvbConverter: no json to parse at all
+        if (EventBinary::matches(file.data()))
         {
-            if (update.value().is_string())
-                game_updates[update.key()] = update.value();
-            else
-                game_updates[update.key()] = update.value().dump();
+            EventBinaryReader reader(file.data());
+            std::string team_a_name(reader.teamA());
+            std::string team_b_name(reader.teamB());
+            onNames(team_a_name, team_b_name);
+
+            EventsScanner::EventView view;
+            while (reader.next(view))
+                if (!onEvent(view.toEvent(team_a_name, team_b_name)))
+                    return false;
+            return true;
         }
 
-        for (auto &update : event["team a updates"].items())
+        EventsScanner scanner(file.data());
+        if (scanner.start())
         {
-            if (update.value().is_string())
-                team_a_updates[update.key()] = update.value();
-            else
-                team_a_updates[update.key()] = update.value().dump();
+            std::string team_a_name(scanner.teamA());
+            std::string team_b_name(scanner.teamB());
+            onNames(team_a_name, team_b_name);
+            namesSent = true;
+
+            EventsScanner::EventView view;
+            EventsScanner::Status status;
+            while ((status = scanner.next(view)) == EventsScanner::Status::EVENT)
+            {
+                if (!onEvent(view.toEvent(team_a_name, team_b_name)))
+                    return false;
+                handedOut++;
+            }
+            if (status == EventsScanner::Status::END)
+                return true;
         }
+    }
 
-        for (auto &update : event["team b updates"].items())
+    // Not laid out the way the scanner expects. Events come out of both in file order, so the
+    // generic parser only has to skip the ones already handed out.
+    size_t skip = handedOut;
+    return parseEventsFileGeneric(json_path,
+                                  [&](const std::string &team_a_name, const std::string &team_b_name) {
+                                      if (!namesSent)
+                                          onNames(team_a_name, team_b_name);
+                                  },
+                                  [&](Event &&event) {
+                                      if (skip > 0)
+                                      {
+                                          skip--;
+                                          return true;
+                                      }
+                                      return onEvent(std::move(event));
+                                  });
+}
+
+// Finds where every event starts and ends in one quick pass, then parses contiguous ranges of
+// them on separate threads and joins the results in order. Returns false, leaving result
+// unspecified, if any part of the file is not laid out the way EventsScanner expects.
+static bool parseEventsFileParallel(const std::string &json_path, size_t threads, names_and_events &result)
+{
+    MappedFile file(json_path);
+    EventsScanner scanner(file.data());
+    if (!scanner.start())
+        return false;
+    result.team_a_name = std::string(scanner.teamA());
+    result.team_b_name = std::string(scanner.teamB());
+
+    std::vector<std::string_view> objects;
+    std::string_view object;
+    EventsScanner::Status status;
+    while ((status = scanner.nextObject(object)) == EventsScanner::Status::EVENT)
+        objects.push_back(object);
+    if (status != EventsScanner::Status::END)
+        return false;
+
+    threads = std::max<size_t>(1, std::min(threads, objects.size()));
+    std::vector<std::vector<Event>> parts(threads);
+    std::vector<char> parsed(threads, 0);
+    // an exception must not escape a worker (that terminates the process): it is kept and rethrown here
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    try
+    {
+        for (size_t part = 0; part < threads; part++)
         {
-            if (update.value().is_string())
-                team_b_updates[update.key()] = update.value();
-            else
-                team_b_updates[update.key()] = update.value().dump();
+            size_t first = objects.size() * part / threads;
+            size_t last = objects.size() * (part + 1) / threads;
+            workers.emplace_back([&, part, first, last]() {
+                try
+                {
+                    std::vector<Event> &events = parts[part];
+                    events.reserve(last - first);
+                    EventsScanner::EventView view;
+                    for (size_t i = first; i < last; i++)
+                    {
+                        if (!EventsScanner::parseEvent(objects[i], view))
+                            return;
+                        events.push_back(view.toEvent(result.team_a_name, result.team_b_name));
+                    }
+                    parsed[part] = 1;
+                }
+                catch (...)
+                {
+                    errors[part] = std::current_exception();
+                }
+            });
         }
-        
-        events.push_back(Event(team_a_name, team_b_name, name, time, game_updates, team_a_updates, team_b_updates, description));
     }
-    names_and_events events_and_names{team_a_name, team_b_name, events};
+    catch (...)
+    {
+        // no thread for the next part: let the started ones finish before unwinding
+        for (std::thread &worker : workers)
+            worker.join();
+        throw;
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    if (std::find(parsed.begin(), parsed.end(), 0) != parsed.end())
+        return false;
+    result.events.reserve(objects.size());
+    for (std::vector<Event> &events : parts)
+        std::move(events.begin(), events.end(), std::back_inserter(result.events));
+    return true;
+}
+
+names_and_events parseEventsFile(std::string json_path, size_t threads)
+{
+    names_and_events events_and_names;
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1)
+    {
+        if (parseEventsFileParallel(json_path, threads, events_and_names))
+            return events_and_names;
+        // read it again in one piece, the generic parser takes over where the scanner gives up
+        events_and_names = names_and_events();
+    }
+
+    // streamed, so only the result is ever held in memory
+    parseEventsFile(json_path,
+                    [&](const std::string &team_a_name, const std::string &team_b_name) {
+                        events_and_names.team_a_name = team_a_name;
+                        events_and_names.team_b_name = team_b_name;
+                    },
+                    [&](Event &&event) {
+                        events_and_names.events.push_back(std::move(event));
+                        return true;
+                    });
 
     return events_and_names;
-}
\ No newline at end of file
+}
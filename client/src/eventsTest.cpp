@@ -0,0 +1,177 @@
+#include "../include/event.h"
+#include "../include/EventBinary.h"
+#include "../include/EventsScanner.h"
+#include "../include/json.hpp"
+#include "../include/TestCheck.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+* Checks that every way of reading an events file gives the same events: the streaming SAX parser
+* against a whole-file DOM parse like the one it replaced, and parseEventsFile, which scans files
+* laid out like ours and hands the rest to the SAX parser, against both; parseEventsFile on several
+* threads too, which has to keep the file's order, and the .evb file EvbConverter makes of it.
+* Usage: EventsTest (run from the client directory; exits with 1 on a failed check)
+*/
+
+using json = nlohmann::json;
+
+// our layout, and one the scanner has to hand over: escapes, floats, nested and null values, extra keys
+static const char *const FIXTURES[] = {"data/events1.json", "data/events1_mismatch.json"};
+
+// an event as one line of text, every field of it
+static std::string describe(const Event &event) {
+    std::ostringstream out;
+    out << event.get_team_a_name() << " | " << event.get_team_b_name() << " | " << event.get_name() << " | "
+        << event.get_time() << " |";
+    for (const std::map<std::string, std::string> *updates :
+         {&event.get_game_updates(), &event.get_team_a_updates(), &event.get_team_b_updates()}) {
+        for (const auto &update : *updates)
+            out << " " << update.first << "=" << update.second << ";";
+        out << " |";
+    }
+    out << " " << event.get_description();
+    return out.str();
+}
+
+// the team names, then one line per event
+typedef std::vector<std::string> Described;
+
+// what parseEventsFile returned before it streamed: the whole file as a DOM
+static Described readWithDom(const std::string &path) {
+    std::ifstream file(path);
+    json data = json::parse(file);
+    std::string team_a_name = data["team a"];
+    std::string team_b_name = data["team b"];
+    Described out;
+    out.push_back(team_a_name + " vs " + team_b_name);
+    for (auto &event : data["events"]) {
+        std::map<std::string, std::string> updates[3];
+        const char *keys[3] = {"general game updates", "team a updates", "team b updates"};
+        for (int i = 0; i < 3; i++)
+            for (auto &update : event[keys[i]].items())
+                updates[i][update.key()] = update.value().is_string() ? update.value().get<std::string>()
+                                                                      : update.value().dump();
+        out.push_back(describe(Event(team_a_name, team_b_name, event["event name"], event["time"], updates[0],
+                                     updates[1], updates[2], event["description"])));
+    }
+    return out;
+}
+
+static Described readWithGeneric(const std::string &path) {
+    Described out;
+    parseEventsFileGeneric(path,
+                           [&](const std::string &team_a_name, const std::string &team_b_name) {
+                               out.push_back(team_a_name + " vs " + team_b_name);
+                           },
+                           [&](Event &&event) {
+                               out.push_back(describe(event));
+                               return true;
+                           });
+    return out;
+}
+
+// parseEventsFile as report uses it: the scanner, or the generic parser when the scanner gives up
+static Described readWithParseEventsFile(const std::string &path) {
+    Described out;
+    parseEventsFile(path,
+                    [&](const std::string &team_a_name, const std::string &team_b_name) {
+                        out.push_back(team_a_name + " vs " + team_b_name);
+                    },
+                    [&](Event &&event) {
+                        out.push_back(describe(event));
+                        return true;
+                    });
+    return out;
+}
+
+// how far EventsScanner gets by itself: the events it read and where it stopped
+static EventsScanner::Status scan(const std::string &path, size_t &events) {
+    MappedFile file(path);
+    EventsScanner scanner(file.data());
+    events = 0;
+    if (!scanner.start())
+        return EventsScanner::Status::MISMATCH;
+    EventsScanner::EventView event;
+    EventsScanner::Status status;
+    while ((status = scanner.next(event)) == EventsScanner::Status::EVENT)
+        events++;
+    return status;
+}
+
+// converted by EvbConverter, and read back as report reads it
+static Described readAsEvb(const std::string &path) {
+    std::string evb = "bin/EventsTest.evb";
+    convertEventsFile(path, evb);
+    CHECK(EventBinary::matches(MappedFile(evb).data()));
+    Described out = readWithParseEventsFile(evb);
+    std::remove(evb.c_str());
+    return out;
+}
+
+// the whole-file parseEventsFile, converting on threads threads
+static Described readOnThreads(const std::string &path, size_t threads) {
+    names_and_events parsed = parseEventsFile(path, threads);
+    Described out;
+    out.push_back(parsed.team_a_name + " vs " + parsed.team_b_name);
+    for (const Event &event : parsed.events)
+        out.push_back(describe(event));
+    return out;
+}
+
+int main() {
+    for (const std::string path : FIXTURES) {
+        Described expected = readWithDom(path);
+        CHECK(expected.size() > 1);
+        CHECK(readWithGeneric(path) == expected);
+        CHECK(readWithParseEventsFile(path) == expected);
+        // more threads than events too
+        for (size_t threads : {1, 2, 4, 8, 16})
+            CHECK(readOnThreads(path, threads) == expected);
+        CHECK(readAsEvb(path) == expected);
+    }
+
+    // a file that breaks off leaves no .evb behind, and one that was there as it was
+    {
+        std::ifstream in("data/events1.json");
+        std::string whole((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream("bin/EventsTest.json") << whole.substr(0, whole.size() / 2);
+        bool thrown = false;
+        try {
+            convertEventsFile("bin/EventsTest.json", "bin/EventsTest.evb");
+        } catch (const std::exception &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(!std::ifstream("bin/EventsTest.evb"));
+
+        convertEventsFile("data/events1.json", "bin/EventsTest.evb");
+        std::string before(MappedFile("bin/EventsTest.evb").data());
+        try {
+            convertEventsFile("bin/EventsTest.json", "bin/EventsTest.evb");
+        } catch (const std::exception &) {
+        }
+        CHECK(std::string(MappedFile("bin/EventsTest.evb").data()) == before);
+        std::remove("bin/EventsTest.evb");
+        std::remove("bin/EventsTest.json");
+    }
+
+    // both paths of parseEventsFile were taken: the scanner read all of our file, and gave up on the other
+    size_t scanned;
+    CHECK(scan("data/events1.json", scanned) == EventsScanner::Status::END);
+    CHECK(scanned == 8);
+    CHECK(scan("data/events1_mismatch.json", scanned) == EventsScanner::Status::MISMATCH);
+
+    // the reference itself reads the fixture right
+    Described events1 = readWithDom("data/events1.json");
+    CHECK(events1.size() == 9);
+    CHECK(events1.front() == "Germany vs Japan");
+    CHECK(events1[1].find("| kickoff | 0 |") != std::string::npos);
+
+    return testResult("EventsTest");
+}
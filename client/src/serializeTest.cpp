@@ -0,0 +1,141 @@
+#include "../include/ConnectionHandler.h"
+#include "../include/StompFrame.h"
+#include "../include/TestCheck.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+* Checks that StompFrame::appendTo() writes exactly what toString() does and, once its buffer has
+* grown, serializes without a single heap allocation; and the same for frames queued through
+* ConnectionHandler::asyncSendSerialized into its pooled send buffers, written to a loopback peer.
+* Usage: SerializeTest (exits with 1 on a failed check)
+*/
+
+// every heap allocation made by the process
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// runs the handler's event loop until it is idle and the peer can read bytes, then reads them
+static std::string writeOut(boost::asio::io_service& io, tcp::socket& peer, size_t bytes) {
+    while (io.poll() > 0 || peer.available() < bytes) {
+    }
+    std::string out(bytes, '\0');
+    boost::asio::read(peer, boost::asio::buffer(&out[0], bytes));
+    return out;
+}
+
+static StompFrame sendFrame(const std::string& body) {
+    std::vector<StompFrame::Header> headers;
+    headers.push_back({"destination", "/topic/Germany_Japan"});
+    headers.push_back({"receipt", "17"});
+    headers.push_back({"filename", "data/events1.json"});
+    headers.push_back({"x-custom", "kept in the list"});
+    return StompFrame(FrameType::SEND, body, headers);
+}
+
+int main() {
+    std::string body =
+        "user: test\n"
+        "team a: Germany\n"
+        "team b: Japan\n"
+        "event name: goal!!!!\n"
+        "time: 1980\n"
+        "general game updates:\n"
+        "active: true\n"
+        "team a updates:\n"
+        "goals: 1\n"
+        "team b updates:\n"
+        "description:\n"
+        "Gundogan scores from the spot.\n";
+    StompFrame small = sendFrame(body);
+    StompFrame large = sendFrame(std::string(64 * 1024, 'x'));
+    StompFrame empty(FrameType::DISCONNECT, "", {{"receipt", "3"}});
+
+    // the same bytes as toString() plus the terminator, and serializedSize() of them
+    for (const StompFrame* frame : {&small, &large, &empty}) {
+        std::string out;
+        frame->appendTo(out);
+        CHECK(out == frame->toString() + '\0');
+        CHECK(out.size() == frame->serializedSize());
+    }
+
+    // appended after what is already in the buffer
+    std::string twice;
+    small.appendTo(twice);
+    small.appendTo(twice);
+    CHECK(twice == small.toString() + '\0' + small.toString() + '\0');
+
+    // steady state: the buffer grew to the largest frame once, after that nothing allocates
+    std::string buffer;
+    large.appendTo(buffer);
+    size_t before = allocations;
+    for (int i = 0; i < 1000; i++) {
+        for (const StompFrame* frame : {&small, &large, &empty}) {
+            buffer.clear();
+            frame->appendTo(buffer);
+        }
+    }
+    size_t allocated = allocations - before;
+    if (allocated != 0)
+        std::cerr << "appendTo allocated " << allocated << " times in steady state" << std::endl;
+    CHECK(allocated == 0);
+
+    // the queued path, with the event loop driven here so queuing is counted apart from writing.
+    // The first round fills the pool, the second grows the pooled buffers that only held the small
+    // frame so far; from the third on queuing is in steady state
+    {
+        boost::asio::io_service io;
+        tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+        ConnectionHandler handler(io, "127.0.0.1", acceptor.local_endpoint().port());
+        CHECK(handler.connect());
+        tcp::socket peer(io);
+        acceptor.accept(peer);
+        handler.startAsyncRead('\0', [](std::string_view, const ConnectionHandler::Slab&) { return true; },
+                               []() {});
+
+        const int QUEUED = 200;
+        const StompFrame* frames[] = {&small, &empty};
+        std::string expected;
+        for (int i = 0; i < QUEUED; i++)
+            frames[i % 2]->appendTo(expected);
+
+        for (int round = 0; round < 3; round++) {
+            size_t before = allocations;
+            for (int i = 0; i < QUEUED; i++) {
+                const StompFrame* frame = frames[i % 2];
+                handler.asyncSendSerialized([frame](std::string& out) { frame->appendTo(out); });
+            }
+            size_t queued = allocations - before;
+            handler.flush();
+            CHECK(writeOut(io, peer, expected.size()) == expected);
+            if (round < 2)
+                continue;
+            // nothing per frame, only the post that wakes the event loop for the batch
+            if (queued > 1)
+                std::cerr << "queuing " << QUEUED << " frames allocated " << queued << " times" << std::endl;
+            CHECK(queued <= 1);
+        }
+    }
+
+    return testResult("SerializeTest");
+}
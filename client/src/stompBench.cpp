@@ -0,0 +1,596 @@
+#include "../include/ConnectionHandler.h"
+#include "../include/StompFrame.h"
+#include "../include/StompParser.h"
+#include "../include/StructuralScanner.h"
+#include "../include/event.h"
+#include "../include/EventsScanner.h"
+#include "../include/EventBinary.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using boost::asio::ip::tcp;
+
+/**
+* Micro benchmarks for the client hot paths.
+* Usage: StompBench [frames] [events]
+* Receive and queued send benchmarks run against a local loopback peer, so no STOMP server is
+* needed; parse and serialize benchmarks work in memory. The events file benchmark writes a synthetic file of
+* `events` events (1M by default) to /tmp and removes it afterwards. That appendTo() does not
+* allocate is checked by SerializeTest; here allocations per frame are only reported.
+*/
+
+// a MESSAGE frame that looks like what the server pushes for a game event
+static std::string sampleMessageFrame() {
+    std::string body =
+        "user: bench\n"
+        "team a: Germany\n"
+        "team b: Japan\n"
+        "event name: goal!!!!\n"
+        "time: 1980\n"
+        "general game updates:\n"
+        "active: true\n"
+        "before halftime: true\n"
+        "team a updates:\n"
+        "goals: 1\n"
+        "possession: 62%\n"
+        "team b updates:\n"
+        "goals: 0\n"
+        "possession: 38%\n"
+        "description:\n"
+        "Gundogan scores from the spot after a clumsy challenge in the box, "
+        "the keeper guessed the right way but could not reach it.\n";
+    return "MESSAGE\n"
+           "subscription:1\n"
+           "message-id:42\n"
+           "destination:/topic/Germany_Japan\n"
+           "\n" + body + "\n";
+}
+
+// every heap allocation made by the process, so benchmarks can report allocations per frame
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// results of the parse benchmarks go here, so the compiler cannot drop the work
+static volatile size_t sink = 0;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const std::string& name, int frames, double seconds) {
+    std::cout << name << ": " << frames << " frames in " << seconds << "s ("
+              << static_cast<long>(frames / seconds) << " frames/sec)" << std::endl;
+}
+
+// accepts one connection on the given acceptor and writes `frames` copies of `frame` (with its '\0')
+static std::thread startWriter(tcp::acceptor& acceptor, const std::string& frame, int frames) {
+    return std::thread([&acceptor, frame, frames]() {
+        boost::asio::io_service io;
+        tcp::socket peer(io);
+        acceptor.accept(peer);
+        std::string batch;
+        for (int i = 0; i < 64; i++) {
+            batch += frame;
+            batch += '\0';
+        }
+        int sent = 0;
+        boost::system::error_code error;
+        while (sent < frames && !error) {
+            int n = std::min(64, frames - sent);
+            boost::asio::write(peer, boost::asio::buffer(batch.data(), n * (frame.size() + 1)), error);
+            sent += n;
+        }
+        peer.close();
+    });
+}
+
+// the previous getFrameAscii: one read_some per byte
+static bool legacyGetFrame(tcp::socket& socket, std::string& frame) {
+    char ch;
+    boost::system::error_code error;
+    do {
+        if (socket.read_some(boost::asio::buffer(&ch, 1), error) != 1 || error)
+            return false;
+        if (ch != '\0')
+            frame.append(1, ch);
+    } while (ch != '\0');
+    return true;
+}
+
+static void benchReceive(int frames) {
+    std::string frame = sampleMessageFrame();
+
+    boost::asio::io_service io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+    unsigned short port = acceptor.local_endpoint().port();
+
+    // byte-at-a-time reader
+    {
+        std::thread writer = startWriter(acceptor, frame, frames);
+        tcp::socket socket(io);
+        socket.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port));
+        auto start = std::chrono::steady_clock::now();
+        int received = 0;
+        std::string raw;
+        while (received < frames && legacyGetFrame(socket, raw)) {
+            raw.clear();
+            received++;
+        }
+        report("recv byte-at-a-time", received, secondsSince(start));
+        writer.join();
+    }
+
+    // buffered ConnectionHandler::getFrameAscii, once per transport
+    const ConnectionHandler::Transport transports[] = {ConnectionHandler::Transport::BOOST,
+                                                       ConnectionHandler::Transport::IO_URING};
+    for (ConnectionHandler::Transport transport : transports) {
+        std::thread writer = startWriter(acceptor, frame, frames);
+        ConnectionHandler handler("127.0.0.1", port, ConnectionHandler::SocketOptions(), transport);
+        if (!handler.connect()) {
+            writer.join();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        int received = 0;
+        std::string raw;
+        while (received < frames && handler.getFrameAscii(raw, '\0')) {
+            raw.clear();
+            received++;
+        }
+        bool uring = handler.getTransport() == ConnectionHandler::Transport::IO_URING;
+        report(uring ? "recv buffered (io_uring)" : "recv buffered", received, secondsSince(start));
+        writer.join();
+    }
+
+    // ConnectionHandler::getFrameView, no copy out of the receive slab
+    {
+        std::thread writer = startWriter(acceptor, frame, frames);
+        ConnectionHandler handler("127.0.0.1", port);
+        if (!handler.connect()) {
+            writer.join();
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        int received = 0;
+        std::string_view view;
+        ConnectionHandler::Slab slab;
+        while (received < frames && handler.getFrameView(view, slab, '\0')) {
+            received++;
+        }
+        report("recv views", received, secondsSince(start));
+        writer.join();
+    }
+}
+
+// the previous StompFrame(const std::string&): copies the frame, then every line, header and the body
+static StompFrame legacyParseFrame(const std::string& frame) {
+    FrameType type = FrameType::MESSAGE;
+    std::vector<StompFrame::Header> headers;
+    std::string body;
+    size_t currentPosition = 0;
+
+    size_t firstNewline = frame.find('\n', currentPosition);
+    if (firstNewline < frame.length()) {
+        type = stringToFrameType(frame.substr(currentPosition, firstNewline - currentPosition));
+        currentPosition = firstNewline + 1;
+    }
+    while (currentPosition < frame.length()) {
+        size_t lineEnd = frame.find('\n', currentPosition);
+        std::string line = frame.substr(currentPosition, lineEnd - currentPosition);
+        currentPosition = lineEnd + 1;
+        if (line.empty()) {
+            break;
+        }
+        size_t colonPos = line.find(':');
+        if (colonPos < line.length()) {
+            headers.push_back(StompFrame::Header(line.substr(0, colonPos), line.substr(colonPos + 1)));
+        }
+    }
+    if (currentPosition < frame.length()) {
+        body = frame.substr(currentPosition);
+        if (body.back() == '\n') {
+            body.pop_back();
+        }
+    }
+    return StompFrame(type, body, headers);
+}
+
+// Feeds a captured stream of `frames` copies of `frame` in segment sized chunks, the way
+// reads hand it over, to the old split-then-parse path and to the streaming parser.
+static void benchParseStream(const std::string& name, const std::string& frame, int frames) {
+    const size_t CHUNK = 1460;  // one TCP segment of payload
+    std::string stream;
+    stream.reserve(frames * (frame.size() + 1));
+    for (int i = 0; i < frames; i++) {
+        stream += frame;
+        stream += '\0';
+    }
+
+    // old path: every chunk is appended and the whole partial frame searched again for the '\0',
+    // then the complete frame is copied and parsed
+    {
+        auto start = std::chrono::steady_clock::now();
+        int parsed = 0;
+        size_t bodyBytes = 0;
+        std::string pending;
+        for (size_t offset = 0; offset < stream.size(); offset += CHUNK) {
+            pending.append(stream, offset, CHUNK);
+            size_t end;
+            while ((end = pending.find('\0')) != std::string::npos) {
+                StompFrame parsedFrame = legacyParseFrame(pending.substr(0, end));
+                bodyBytes += parsedFrame.getBody().size();
+                pending.erase(0, end + 1);
+                parsed++;
+            }
+        }
+        report("parse " + name + " split+copy", parsed, secondsSince(start));
+        sink = bodyBytes;
+    }
+
+    // StompParser over the growing in-place buffer, resuming where it stopped
+    {
+        auto start = std::chrono::steady_clock::now();
+        int parsed = 0;
+        size_t bodyBytes = 0;
+        StompParser parser;
+        size_t frameStart = 0;
+        for (size_t available = 0; available < stream.size();) {
+            available = std::min(stream.size(), available + CHUNK);
+            size_t length;
+            while ((length = parser.parse(std::string_view(stream).substr(frameStart, available - frameStart))) > 0) {
+                bodyBytes += parser.frame().body.length;
+                frameStart += length;
+                parsed++;
+            }
+        }
+        report("parse " + name + " streaming", parsed, secondsSince(start));
+        sink = bodyBytes;
+    }
+}
+
+static void benchParse(int frames) {
+    benchParseStream("event", sampleMessageFrame(), frames);
+
+    // a large frame framed by content-length, whose body the streaming parser never scans
+    std::string body(64 * 1024, 'x');
+    std::string large = "MESSAGE\n"
+                        "subscription:1\n"
+                        "message-id:42\n"
+                        "destination:/topic/Germany_Japan\n"
+                        "content-length:" + std::to_string(body.size()) + "\n"
+                        "\n" + body;
+    benchParseStream("64KiB", large, std::max(1, frames / 100));
+}
+
+// Runs StructuralScanner alone over a stream of MESSAGE frames, then parses the frames and the
+// event in each body, once per scanner implementation. Parsing is mostly building the Events, so
+// the scanner's share of it only shows in the first; that is timed as the best of a few passes
+static void benchScan(int frames) {
+    std::string stream;
+    std::string frame = sampleMessageFrame();
+    for (int i = 0; i < frames; i++) {
+        stream += frame;
+        stream += '\0';
+    }
+
+    const StructuralScanner::Isa isas[] = {StructuralScanner::Isa::SCALAR, StructuralScanner::Isa::SSE2,
+                                           StructuralScanner::Isa::AVX2};
+    StructuralScanner::Isa original = StructuralScanner::getIsa();
+    for (StructuralScanner::Isa isa : isas) {
+        if (StructuralScanner::setIsa(isa) != isa) {
+            continue;
+        }
+        double best = 0;
+        size_t positions = 0;
+        for (int pass = 0; pass < 5; pass++) {
+            auto start = std::chrono::steady_clock::now();
+            StructuralScanner scanner(stream);
+            positions = 0;
+            while (scanner.next() != StructuralScanner::npos) {
+                positions++;
+            }
+            double seconds = secondsSince(start);
+            best = pass == 0 ? seconds : std::min(best, seconds);
+        }
+        report(std::string("scan structural (") + StructuralScanner::isaName(isa) + ")", frames, best);
+        std::cout << "  " << static_cast<long>(stream.size() / best / 1e6) << " MB/s" << std::endl;
+        sink = positions;
+    }
+    for (StructuralScanner::Isa isa : isas) {
+        if (StructuralScanner::setIsa(isa) != isa) {
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        int parsed = 0;
+        size_t fields = 0;
+        StompParser parser;
+        std::string_view rest(stream);
+        size_t length;
+        while ((length = parser.parse(rest)) > 0) {
+            Event event(parser.frame().body.in(rest));
+            fields += event.get_team_a_updates().size() + event.get_description().size();
+            rest.remove_prefix(length);
+            parsed++;
+        }
+        report(std::string("parse frame+event (") + StructuralScanner::isaName(isa) + ")", parsed,
+               secondsSince(start));
+        sink = fields;
+    }
+    StructuralScanner::setIsa(original);
+}
+
+// a SEND frame like the ones report publishes
+static StompFrame sampleSendFrame() {
+    std::string body = sampleMessageFrame();
+    body = body.substr(body.find("\n\n") + 2);
+    std::vector<StompFrame::Header> headers;
+    headers.push_back({"destination", "/topic/Germany_Japan"});
+    headers.push_back({"receipt", "17"});
+    headers.push_back({"filename", "data/events1.json"});
+    return StompFrame(FrameType::SEND, body, headers);
+}
+
+// Serializes the same frame with toString() and with appendTo() into a reused buffer
+static void benchSerialize(int frames) {
+    StompFrame frame = sampleSendFrame();
+
+    {
+        size_t before = allocations;
+        auto start = std::chrono::steady_clock::now();
+        size_t bytes = 0;
+        for (int i = 0; i < frames; i++) {
+            bytes += frame.toString().size();
+        }
+        size_t allocated = allocations - before;
+        report("serialize toString", frames, secondsSince(start));
+        std::cout << "  " << static_cast<double>(allocated) / frames << " allocations/frame" << std::endl;
+        sink = bytes;
+    }
+
+    std::string buffer;
+    frame.appendTo(buffer);  // warm up: grow the buffer once
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (int i = 0; i < frames; i++) {
+        buffer.clear();
+        frame.appendTo(buffer);
+        bytes += buffer.size();
+    }
+    size_t allocated = allocations - before;
+    report("serialize appendTo", frames, secondsSince(start));
+    std::cout << "  " << static_cast<double>(allocated) / frames << " allocations/frame" << std::endl;
+    sink = bytes;
+}
+
+// Queues `frames` SEND frames on the asynchronous path under each flush policy and times them until
+// a loopback peer has read them all; the peer's reads show how the policy coalesced the writes
+static void benchFlush(int frames) {
+    std::string frame = sampleSendFrame().toString();
+    size_t expected = static_cast<size_t>(frames) * (frame.size() + 1);
+
+    boost::asio::io_service io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+    unsigned short port = acceptor.local_endpoint().port();
+
+    typedef ConnectionHandler::FlushPolicy Policy;
+    auto policy = [](Policy::Mode mode, size_t sizeThreshold, long deadlineMicros, bool cork) {
+        Policy p;
+        p.mode = mode;
+        p.sizeThreshold = sizeThreshold;
+        p.deadlineMicros = deadlineMicros;
+        p.cork = cork;
+        return p;
+    };
+    const std::pair<std::string, Policy> cases[] = {
+        {"immediate", Policy()},
+        {"size 64KiB, 200us", policy(Policy::SIZE_THRESHOLD, 64 * 1024, 200, false)},
+        {"deadline 200us", policy(Policy::DEADLINE, 0, 200, false)},
+        {"deadline 200us, corked", policy(Policy::DEADLINE, 0, 200, true)},
+    };
+
+    for (const auto& c : cases) {
+        size_t reads = 0;
+        std::thread reader([&]() {
+            tcp::socket peer(io);
+            acceptor.accept(peer);
+            std::vector<char> buffer(ConnectionHandler::RECEIVE_CHUNK * 8);
+            size_t received = 0;
+            boost::system::error_code error;
+            while (received < expected && !error) {
+                received += peer.read_some(boost::asio::buffer(buffer), error);
+                reads++;
+            }
+            peer.close();
+        });
+        ConnectionHandler handler("127.0.0.1", port);
+        if (!handler.connect()) {
+            reader.join();
+            return;
+        }
+        handler.setFlushPolicy(c.second);
+        // the peer never writes; its close ends the read loop and with it run()
+        handler.startAsyncRead('\0', [](std::string_view, const ConnectionHandler::Slab&) { return true; },
+                               []() {});
+        std::thread loop([&handler]() { handler.run(); });
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++) {
+            handler.asyncSendFrameAscii(frame, '\0');
+        }
+        handler.flush();
+        reader.join();
+        report("send queued, " + c.first, frames, secondsSince(start));
+        std::cout << "  " << static_cast<double>(frames) / reads << " frames/read at the peer" << std::endl;
+        loop.join();
+    }
+}
+
+// writes an events file shaped like data/events1.json with `events` events
+static void writeEventsFile(const std::string& path, int events) {
+    std::ofstream out(path);
+    out << "{\n    \"team a\": \"Germany\",\n    \"team b\": \"Japan\",\n    \"events\": [";
+    for (int i = 0; i < events; i++) {
+        out << (i == 0 ? "\n" : ",\n")
+            << "        {\n"
+               "            \"event name\": \"event " << i << "\",\n"
+               "            \"time\": " << i * 7 << ",\n"
+               "            \"general game updates\": {\n"
+               "                \"active\": true,\n"
+               "                \"before halftime\": " << (i < events / 2 ? "true" : "false") << "\n"
+               "            },\n"
+               "            \"team a updates\": {\n"
+               "                \"goals\": \"" << i % 5 << "\",\n"
+               "                \"possession\": \"" << 40 + i % 20 << "%\"\n"
+               "            },\n"
+               "            \"team b updates\": {\n"
+               "                \"shots\": " << i % 11 << "\n"
+               "            },\n"
+               "            \"description\": \"Gundogan scores from the spot after a clumsy challenge in the box, "
+               "the keeper guessed the right way but could not reach it.\"\n"
+               "        }";
+    }
+    out << "\n    ]\n}\n";
+}
+
+// Reads a synthetic events file with the generic SAX parser, with EventsScanner alone (views into
+// the mapping) and with parseEventsFile (scanner plus building each Event), the same for its .evb
+// conversion, then into a vector on a growing number of threads
+static void benchEventsFile(int events) {
+    char path[] = "/tmp/stompBenchEventsXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::cerr << "cannot create a file in /tmp, skipping the events file benchmark" << std::endl;
+        return;
+    }
+    close(fd);
+    writeEventsFile(path, events);
+
+    auto noNames = [](const std::string&, const std::string&) {};
+    {
+        auto start = std::chrono::steady_clock::now();
+        int read = 0;
+        size_t fields = 0;
+        parseEventsFileGeneric(path, noNames, [&](Event&& event) {
+            fields += event.get_team_a_updates().size() + event.get_description().size();
+            read++;
+            return true;
+        });
+        report("events file generic", read, secondsSince(start));
+        sink = fields;
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        int read = 0;
+        size_t fields = 0;
+        MappedFile file(path);
+        EventsScanner scanner(file.data());
+        EventsScanner::EventView view;
+        if (scanner.start()) {
+            while (scanner.next(view) == EventsScanner::Status::EVENT) {
+                fields += view.team_a_updates.size() + view.description.size();
+                read++;
+            }
+        }
+        report("events file scanner views", read, secondsSince(start));
+        sink = fields;
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        int read = 0;
+        size_t fields = 0;
+        parseEventsFile(path, noNames, [&](Event&& event) {
+            fields += event.get_team_a_updates().size() + event.get_description().size();
+            read++;
+            return true;
+        });
+        report("events file parseEventsFile", read, secondsSince(start));
+        sink = fields;
+    }
+
+    // the same events converted to .evb once, then read back as views and as Events
+    std::string evbPath = std::string(path) + ".evb";
+    convertEventsFile(path, evbPath);
+    {
+        auto start = std::chrono::steady_clock::now();
+        int read = 0;
+        size_t fields = 0;
+        MappedFile file(evbPath);
+        EventBinaryReader reader(file.data());
+        EventsScanner::EventView view;
+        while (reader.next(view)) {
+            fields += view.team_a_updates.size() + view.description.size();
+            read++;
+        }
+        report("events file evb views", read, secondsSince(start));
+        sink = fields;
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        int read = 0;
+        size_t fields = 0;
+        parseEventsFile(evbPath, noNames, [&](Event&& event) {
+            fields += event.get_team_a_updates().size() + event.get_description().size();
+            read++;
+            return true;
+        });
+        report("events file evb parseEventsFile", read, secondsSince(start));
+        sink = fields;
+    }
+    unlink(evbPath.c_str());
+
+    // the whole file into a vector, converted on 1, 2, 4 and 8 threads
+    std::cout << "  " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    for (size_t threads : {1, 2, 4, 8}) {
+        auto start = std::chrono::steady_clock::now();
+        names_and_events parsed = parseEventsFile(path, threads);
+        report("events file vector, " + std::to_string(threads) + " threads", static_cast<int>(parsed.events.size()),
+               secondsSince(start));
+        sink = parsed.events.size();
+    }
+
+    unlink(path);
+}
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int events = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+    benchReceive(frames);
+    benchParse(frames);
+    benchScan(frames);
+    benchEventsFile(events);
+    benchSerialize(frames);
+    benchFlush(frames);
+    return 0;
+}
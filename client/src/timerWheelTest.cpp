@@ -0,0 +1,118 @@
+#include "../include/TimerWheel.h"
+#include "../include/TestCheck.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+* Checks that TimerWheel fires every timer on its tick and in order: timers due together in the
+* order they were added, timers of every level after they moved down the wheels, and the same as
+* an ordered multimap over random schedules.
+* Usage: TimerWheelTest (exits with 1 on a failed check)
+*/
+
+// (expiry, id) of the timers fired, in firing order
+typedef std::vector<std::pair<uint64_t, uint64_t>> Fired;
+
+static void advance(TimerWheel &wheel, uint64_t tick, Fired &fired) {
+    wheel.advance(tick, [&](uint64_t id, uint64_t expiry) { fired.push_back({expiry, id}); });
+}
+
+int main() {
+    // the same tick: in the order they were added
+    {
+        TimerWheel wheel;
+        for (uint64_t id = 0; id < 5; id++)
+            wheel.schedule(3, id);
+        Fired fired;
+        advance(wheel, 2, fired);
+        CHECK(fired.empty());
+        advance(wheel, 3, fired);
+        CHECK(fired == Fired({{3, 0}, {3, 1}, {3, 2}, {3, 3}, {3, 4}}));
+        CHECK(wheel.empty());
+    }
+
+    // ... also when the first came down from a coarser wheel into a slot the second was added to directly
+    {
+        TimerWheel wheel;
+        wheel.schedule(300, 1);
+        Fired fired;
+        advance(wheel, 99, fired);
+        wheel.schedule(300, 2);
+        advance(wheel, 300, fired);
+        CHECK(fired == Fired({{300, 1}, {300, 2}}));
+    }
+
+    // one timer placed on each level, added latest first: each fires on its own tick, not one
+    // earlier, after cascading down from its level. One past the last wheel is parked, and still
+    // pending after the coarsest wheel turned
+    {
+        const uint64_t expiries[] = {
+            (uint64_t(1) << 24) + 12345,  // level 3
+            70000,                        // level 2
+            TimerWheel::SLOTS + 44,       // level 1, and due as the finest wheel is in another turn
+            TimerWheel::SLOTS,            // level 1, due exactly as the finest wheel wraps
+            200,                          // level 0
+        };
+        TimerWheel wheel;
+        for (uint64_t id = 0; id < 5; id++)
+            wheel.schedule(expiries[id], id);
+        wheel.schedule(uint64_t(1) << 33, 5);
+        Fired fired;
+        for (uint64_t id = 5; id-- > 0;) {
+            size_t before = fired.size();
+            CHECK(wheel.nextDeadline() <= expiries[id]);
+            advance(wheel, expiries[id] - 1, fired);
+            CHECK(fired.size() == before);
+            advance(wheel, expiries[id], fired);
+            CHECK(fired.size() == before + 1 && fired.back() == std::make_pair(expiries[id], id));
+        }
+        CHECK(wheel.size() == 1);
+    }
+
+    // an expiry already passed fires on the next tick run
+    {
+        TimerWheel wheel;
+        Fired fired;
+        advance(wheel, 1000, fired);
+        wheel.schedule(10, 7);
+        advance(wheel, 1001, fired);
+        CHECK(fired == Fired({{1001, 7}}));
+    }
+
+    // random schedules against a multimap, which fires by expiry and, on a tie, in insertion order
+    std::mt19937_64 random(1);
+    for (int round = 0; round < 4; round++) {
+        TimerWheel wheel;
+        std::multimap<uint64_t, uint64_t> reference;
+        Fired fired, expected;
+        uint64_t now = 0;
+        uint64_t id = 0;
+        for (int step = 0; step < 400; step++) {
+            for (int added = random() % 5; added > 0; added--) {
+                const uint64_t ranges[] = {300, 70000, 20000000};
+                uint64_t expiry = now + random() % ranges[random() % 3];
+                wheel.schedule(expiry, id);
+                reference.emplace(expiry, id);
+                id++;
+            }
+            if (!reference.empty())
+                CHECK(wheel.nextDeadline() <= reference.begin()->first);
+
+            uint64_t to = now + (random() % 2 ? random() % 10 : random() % 20000);
+            advance(wheel, to, fired);
+            while (!reference.empty() && reference.begin()->first <= to) {
+                expected.push_back(*reference.begin());
+                reference.erase(reference.begin());
+            }
+            now = to + 1;
+        }
+        CHECK(fired == expected);
+        CHECK(wheel.size() == reference.size());
+    }
+
+    return testResult("TimerWheelTest");
+}
@@ -11,6 +11,9 @@ public enum FrameType {
     SUBSCRIBE,
     UNSUBSCRIBE,
     DISCONNECT,
+    BEGIN,
+    COMMIT,
+    ABORT,
     MESSAGE,
     RECEIPT,
     ERROR,
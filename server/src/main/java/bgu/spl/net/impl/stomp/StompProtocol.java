@@ -1,5 +1,7 @@
 package bgu.spl.net.impl.stomp;
 
+import java.nio.charset.StandardCharsets;
+import java.util.HashMap;
 import java.util.Vector;
 import java.util.concurrent.ConcurrentHashMap;
 import java.util.concurrent.atomic.AtomicInteger;
@@ -19,6 +21,8 @@ public class StompProtocol implements StompMessagingProtocol<StompFrame> {
     private boolean loggedIn = false;
     private final Database database = Database.getInstance();
     private String currentUser = null;
+    // SENDs of the transactions begun on this connection, published on COMMIT and dropped on ABORT
+    private final HashMap<String, Vector<StompFrame>> transactions = new HashMap<>();
 
 
 
@@ -47,6 +51,7 @@ public class StompProtocol implements StompMessagingProtocol<StompFrame> {
             }
 
             loggedIn = false;
+            transactions.clear();
             database.logout(connectionId);
             connections.send(connectionId, receipt);
             connections.disconnect(connectionId);
@@ -59,48 +64,44 @@ public class StompProtocol implements StompMessagingProtocol<StompFrame> {
                 return;
             }
 
-            String dest = message.getHeaderValue("destination");
-            if(dest == null || dest.isEmpty()) {
-                terminate(receiptHeader, "No destination provided", "");  
-                return; 
+            // inside a transaction it is only kept; COMMIT publishes it
+            String transaction = message.getHeaderValue("transaction");
+            if (!transaction.isEmpty()) {
+                Vector<StompFrame> sends = transactions.get(transaction);
+                if (sends == null) {
+                    terminate(receiptHeader, "No such transaction: " + transaction, "");
+                    return;
+                }
+                sends.add(message);
             }
-            
-                
-            ConcurrentHashMap<Integer, String> subscribers = connections.getSubscribers(dest);
-
-            if(subscribers.isEmpty() || connections.getSubscriptionId(connectionId, dest) == null) {
-                terminate(receiptHeader, "The user is not subscribed to the channel", "");
+            else if (!publish(message, receiptHeader)) {
                 return;
             }
-
-
-            String filename = message.getHeaderValue("filename");
-            if (filename == null || filename.isEmpty()) {
-                filename = "REPORT";
+        }
+        else if (message.getType() == FrameType.BEGIN) {
+            String transaction = message.getHeaderValue("transaction");
+            if (!loggedIn || transaction.isEmpty() || transactions.containsKey(transaction)) {
+                terminate(receiptHeader, "Wrong format for BEGIN", "");
+                return;
             }
-
-            String gameChannel = dest.replaceFirst("^/topic/", "");
-
-            database.trackFileUpload(currentUser, filename, gameChannel);
-                
-            int msgId = MessageIdCounter.getAndIncrement();
-
-            for(Integer clientId : subscribers.keySet()){
-                String subscriberId = subscribers.get(clientId);
-
-                Vector<StompFrame.Header> headers = new Vector<>();
-                headers.add(new StompFrame.Header("subscription", subscriberId));
-                headers.add(new StompFrame.Header("message-id", String.valueOf(msgId)));
-                headers.add(new StompFrame.Header("destination", dest));
-            
-                StompFrame frame = new StompFrame(FrameType.MESSAGE, message.getBody(), headers);
-
-                try {
-                    connections.send(clientId, frame);
-                } catch(Exception e) {
-                    terminate(receiptHeader, "Couldn't send the message to one or more subscribers", "");
+            transactions.put(transaction, new Vector<>());
+        }
+        else if (message.getType() == FrameType.COMMIT) {
+            // the receipt, if asked for, goes out below once every SEND of the transaction was published
+            Vector<StompFrame> sends = transactions.remove(message.getHeaderValue("transaction"));
+            if (sends == null) {
+                terminate(receiptHeader, "Wrong format for COMMIT", "");
+                return;
+            }
+            for (StompFrame send : sends) {
+                if (!publish(send, receiptHeader))
                     return;
-                }
+            }
+        }
+        else if (message.getType() == FrameType.ABORT) {
+            if (transactions.remove(message.getHeaderValue("transaction")) == null) {
+                terminate(receiptHeader, "Wrong format for ABORT", "");
+                return;
             }
         }
         else if (message.getType() == FrameType.CONNECT) {
@@ -198,13 +199,74 @@ public class StompProtocol implements StompMessagingProtocol<StompFrame> {
             currentUser = null;
         }
 
-        // STOMP ERROR should close the connection
+        // STOMP ERROR should close the connection, and with it any transaction left open
+        transactions.clear();
         connections.disconnect(connectionId);
         shouldTerminate = true;
     }
 
     //HELPERS
 
+    /**
+     * sends a MESSAGE with the SEND's body to every subscriber of its destination
+     * @return false if the SEND was refused and the connection is closing
+     */
+    private boolean publish(StompFrame message, StompFrame.Header receiptHeader) {
+        String dest = message.getHeaderValue("destination");
+        if(dest == null || dest.isEmpty()) {
+            terminate(receiptHeader, "No destination provided", "");  
+            return false; 
+        }
+        
+            
+        ConcurrentHashMap<Integer, String> subscribers = connections.getSubscribers(dest);
+
+        if(subscribers.isEmpty() || connections.getSubscriptionId(connectionId, dest) == null) {
+            terminate(receiptHeader, "The user is not subscribed to the channel", "");
+            return false;
+        }
+
+
+        String filename = message.getHeaderValue("filename");
+        if (filename == null || filename.isEmpty()) {
+            filename = "REPORT";
+        }
+
+        String gameChannel = dest.replaceFirst("^/topic/", "");
+
+        database.trackFileUpload(currentUser, filename, gameChannel);
+            
+        int msgId = MessageIdCounter.getAndIncrement();
+
+        // a batched SEND (report --batch) holds several length-prefixed events; subscribers need its
+        // record count, and the body's exact length, to split it again
+        String batchCount = message.getHeaderValue("batch-count");
+        String contentLength = String.valueOf(message.getBody().getBytes(StandardCharsets.UTF_8).length);
+
+        for(Integer clientId : subscribers.keySet()){
+            String subscriberId = subscribers.get(clientId);
+
+            Vector<StompFrame.Header> headers = new Vector<>();
+            headers.add(new StompFrame.Header("subscription", subscriberId));
+            headers.add(new StompFrame.Header("message-id", String.valueOf(msgId)));
+            headers.add(new StompFrame.Header("destination", dest));
+            if (!batchCount.isEmpty()) {
+                headers.add(new StompFrame.Header("batch-count", batchCount));
+                headers.add(new StompFrame.Header("content-length", contentLength));
+            }
+        
+            StompFrame frame = new StompFrame(FrameType.MESSAGE, message.getBody(), headers);
+
+            try {
+                connections.send(clientId, frame);
+            } catch(Exception e) {
+                terminate(receiptHeader, "Couldn't send the message to one or more subscribers", "");
+                return false;
+            }
+        }
+        return true;
+    }
+
     private StompFrame generateReceipt(int id) {
         Vector<StompFrame.Header> headers = new Vector<StompFrame.Header>();
         headers.add(new StompFrame.Header("receipt-id", Integer.toString(id)));
@@ -0,0 +1,155 @@
+package bgu.spl.net.impl.stomp;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertTrue;
+import org.junit.jupiter.api.Test;
+
+import bgu.spl.net.srv.ConnectionHandler;
+import bgu.spl.net.srv.ConnectionsImpl;
+
+public class StompProtocolTest {
+
+    // the Database is shared by every test: each client gets a connection id and user of its own
+    private static final AtomicInteger nextId = new AtomicInteger(1000);
+
+    // keeps every frame the server sends to one connection
+    private static class RecordingHandler implements ConnectionHandler<StompFrame> {
+        final List<StompFrame> sent = new ArrayList<>();
+
+        @Override
+        public void send(StompFrame msg) {
+            sent.add(msg);
+        }
+
+        @Override
+        public void close() {
+        }
+    }
+
+    private static class Client {
+        final StompProtocol protocol = new StompProtocol();
+        final RecordingHandler handler = new RecordingHandler();
+
+        void process(String rawFrame) {
+            protocol.process(new StompFrame(rawFrame));
+        }
+
+        StompFrame last() {
+            return handler.sent.get(handler.sent.size() - 1);
+        }
+    }
+
+    private final ConnectionsImpl<StompFrame> connections = new ConnectionsImpl<>();
+
+    // a logged in client subscribed to destination
+    private Client subscribedClient(String destination) {
+        int id = nextId.getAndIncrement();
+        Client client = new Client();
+        connections.connect(id, client.handler);
+        client.protocol.start(id, connections);
+        client.process("CONNECT\naccept-version:1.2\nhost:stomp.cs.bgu.ac.il\nlogin:user" + id + "\npasscode:pw\n\n\0");
+        client.process("SUBSCRIBE\ndestination:" + destination + "\nid:" + id + "\n\n\0");
+        return client;
+    }
+
+    @Test
+    public void testBatchedSendKeepsCountAndLength() {
+        Client sender = subscribedClient("/topic/batch");
+        Client subscriber = subscribedClient("/topic/batch");
+
+        sender.process("SEND\ndestination:/topic/batch\nbatch-count:2\ncontent-length:9\n\n3\nabc2\nde\0");
+
+        StompFrame message = subscriber.last();
+        assertEquals(FrameType.MESSAGE, message.getType());
+        assertEquals("2", message.getHeaderValue("batch-count"));
+        assertEquals("9", message.getHeaderValue("content-length"));
+        assertEquals("3\nabc2\nde", message.getBody());
+    }
+
+    @Test
+    public void testBatchLengthCountsBytes() {
+        Client sender = subscribedClient("/topic/batch-utf8");
+        Client subscriber = subscribedClient("/topic/batch-utf8");
+
+        // three characters, but u-umlaut is two bytes in UTF-8
+        sender.process("SEND\ndestination:/topic/batch-utf8\nbatch-count:1\ncontent-length:4\n\n2\n\u00fc\0");
+
+        assertEquals("4", subscriber.last().getHeaderValue("content-length"));
+    }
+
+    @Test
+    public void testPlainSendHasNoBatchHeaders() {
+        Client sender = subscribedClient("/topic/plain");
+        Client subscriber = subscribedClient("/topic/plain");
+
+        sender.process("SEND\ndestination:/topic/plain\n\nuser: a\n\0");
+
+        StompFrame message = subscriber.last();
+        assertEquals(FrameType.MESSAGE, message.getType());
+        assertEquals("", message.getHeaderValue("batch-count"));
+        assertEquals("", message.getHeaderValue("content-length"));
+    }
+
+    @Test
+    public void testCommitPublishesTheTransaction() {
+        Client sender = subscribedClient("/topic/tx");
+        Client subscriber = subscribedClient("/topic/tx");
+        int before = subscriber.handler.sent.size();
+
+        sender.process("BEGIN\ntransaction:tx-1\n\n\0");
+        sender.process("SEND\ndestination:/topic/tx\ntransaction:tx-1\n\nfirst\0");
+        sender.process("SEND\ndestination:/topic/tx\ntransaction:tx-1\n\nsecond\0");
+        assertEquals(before, subscriber.handler.sent.size());
+
+        sender.process("COMMIT\ntransaction:tx-1\nreceipt:42\n\n\0");
+        assertEquals(before + 2, subscriber.handler.sent.size());
+        assertEquals("first", subscriber.handler.sent.get(before).getBody());
+        assertEquals("second", subscriber.handler.sent.get(before + 1).getBody());
+        assertEquals(FrameType.RECEIPT, sender.last().getType());
+        assertEquals("42", sender.last().getHeaderValue("receipt-id"));
+        assertFalse(sender.protocol.shouldTerminate());
+    }
+
+    @Test
+    public void testAbortDropsTheTransaction() {
+        Client sender = subscribedClient("/topic/tx-abort");
+        Client subscriber = subscribedClient("/topic/tx-abort");
+        int before = subscriber.handler.sent.size();
+
+        sender.process("BEGIN\ntransaction:tx-1\n\n\0");
+        sender.process("SEND\ndestination:/topic/tx-abort\ntransaction:tx-1\n\ndropped\0");
+        sender.process("ABORT\ntransaction:tx-1\nreceipt:7\n\n\0");
+
+        assertEquals(before, subscriber.handler.sent.size());
+        assertEquals("7", sender.last().getHeaderValue("receipt-id"));
+
+        // the id is free again
+        sender.process("BEGIN\ntransaction:tx-1\n\n\0");
+        assertFalse(sender.protocol.shouldTerminate());
+    }
+
+    @Test
+    public void testSendInAnUnknownTransactionIsAnError() {
+        Client sender = subscribedClient("/topic/tx-unknown");
+
+        sender.process("SEND\ndestination:/topic/tx-unknown\ntransaction:missing\n\nbody\0");
+
+        assertEquals(FrameType.ERROR, sender.last().getType());
+        assertTrue(sender.protocol.shouldTerminate());
+    }
+
+    @Test
+    public void testCommitWithoutBeginIsAnError() {
+        Client sender = subscribedClient("/topic/tx-commit");
+
+        sender.process("COMMIT\ntransaction:tx-9\nreceipt:1\n\n\0");
+
+        assertEquals(FrameType.ERROR, sender.last().getType());
+        assertTrue(sender.protocol.shouldTerminate());
+    }
+}